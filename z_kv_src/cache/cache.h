@@ -51,15 +51,15 @@ class ShardCache final : public Cache<KeyType, ValueType> {
   }
   //由key的hash决定它使用哪个cache
   void Insert(const KeyType& key, ValueType* value, uint32_t ttl = 0) {
-    uint64_t shard_num = std::hash<KeyType>{}(key) % kShardNum;
+    uint64_t shard_num = CacheKeyHash(key) % kShardNum;
     cache_impl_[shard_num]->Insert(key, value, ttl);
   }
   CacheNode<KeyType, ValueType>* Get(const KeyType& key) {
-    uint64_t shard_num = std::hash<KeyType>{}(key) % kShardNum;
+    uint64_t shard_num = CacheKeyHash(key) % kShardNum;
     return cache_impl_[shard_num]->Get(key);
   }
   void Release(CacheNode<KeyType, ValueType>* node) {
-    uint64_t shard_num = std::hash<KeyType>{}(node->key) % kShardNum;
+    uint64_t shard_num = CacheKeyHash(node->key) % kShardNum;
     return cache_impl_[shard_num]->Release(node);
   }
   void Prune() {
@@ -68,7 +68,7 @@ class ShardCache final : public Cache<KeyType, ValueType> {
     }
   }
   void Erase(const KeyType& key) {
-    uint64_t shard_num = std::hash<KeyType>{}(key) % kShardNum;
+    uint64_t shard_num = CacheKeyHash(key) % kShardNum;
     return cache_impl_[shard_num]->Erase(key);
   }
   void RegistCleanHandle(
@@ -78,9 +78,11 @@ class ShardCache final : public Cache<KeyType, ValueType> {
     }
   }
 
- private:
-  // 默认分为5个shard
+ public:
+  // 默认分为4个shard，每个shard的容量都是capacity
   static constexpr uint8_t kShardNum = 4;
+
+ private:
   // 采用impl的机制来进行实现
   std::vector<std::shared_ptr<CachePolicy<KeyType, ValueType>>> cache_impl_;
 };
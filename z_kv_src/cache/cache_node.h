@@ -1,8 +1,25 @@
 #pragma once
 #include <functional>
+#include <string_view>
+#include <type_traits>
+
+#include "../utils/hash_util.h"
 
 //缓存节点的结构定义
 namespace z_kv {
+// 缓存key的hash，用于选择分片：字符串按内容，整数等定长类型按字节计算Hash64
+// std::hash对整数是恒等映射，block cache的key(sst_id<<32|offset)取模之后会集中到少数分片
+template <typename KeyType>
+inline uint64_t CacheKeyHash(const KeyType& key) {
+  if constexpr (std::is_convertible_v<const KeyType&, std::string_view>) {
+    const std::string_view data(key);
+    return hash_util::Hash64(data.data(), data.size());
+  } else {
+    static_assert(std::is_trivially_copyable_v<KeyType>,
+                  "cache key must be a string or trivially copyable");
+    return hash_util::Hash64(reinterpret_cast<const char*>(&key), sizeof(key));
+  }
+}
 template <typename KeyType, typename ValueType>
 struct CacheNode {
   // key的话我们保证他是深度复制的
@@ -20,23 +20,25 @@ class LruCachePolicy final : public CachePolicy<KeyType, ValueType> {
 
  public:
   LruCachePolicy(uint32_t capacity) : capacity_(capacity) {}
-  // 其实走到这里，说明整个程序都结束了,系统负责释放就行
+  // 释放缓存持有的引用，外部仍在使用的node由最后一次Release释放
   ~LruCachePolicy() {
     for (auto it = nodes_.begin(); it != nodes_.end(); it++) {
-      // Unref(it);
+      (*it)->in_cache = false;
+      Unref(*it);
     }
+    nodes_.clear();
+    index_.clear();
   }
   
   //在缓存中插入数据
   void Insert(const KeyType& key, ValueType* value, uint32_t ttl = 0) {
     //加锁
-    LockType lock_type;
-    ScopedLockImpl<LockType> lock_guard(lock_type);
+    ScopedLockImpl<LockType> lock_guard(lock_);
     //定义新节点
     CacheNode<KeyType, ValueType>* new_node =
         new CacheNode<KeyType, ValueType>();
     //生成hash
-    new_node->hash = std::hash<KeyType>{}(key);
+    new_node->hash = static_cast<uint32_t>(CacheKeyHash(key));
     new_node->key = key;
     new_node->value = value;
     new_node->in_cache = true;
@@ -66,18 +68,18 @@ class LruCachePolicy final : public CachePolicy<KeyType, ValueType> {
       index_[key] = nodes_.begin();
     } else {
       //说明已经存在有新的值
-      //更新节点的值，并将其加到第一个位置
-      FinishErase(*(iter->second));
-      //将nodes_中迭代器index_[key]位置上的元素拼接到,nodes_中nodes_.begin()之前
-      nodes_.splice(nodes_.begin(), nodes_, index_[key]);
+      //旧节点移出缓存(仍被持有时等待释放)，新节点放到第一个位置
+      CacheNode<KeyType, ValueType>* old_node = *(iter->second);
+      nodes_.erase(iter->second);
+      FinishErase(old_node);
+      nodes_.push_front(new_node);
       index_[key] = nodes_.begin();
     }
   }
 
   //从缓存中获取元素，不存在就返回nullptr ，存在就返回，并1.更新其在缓存中位置 2.引用计数+1
   CacheNode<KeyType, ValueType>* Get(const KeyType& key) {
-    LockType lock_type;
-    ScopedLockImpl<LockType> lock_guard(lock_type);
+    ScopedLockImpl<LockType> lock_guard(lock_);
     typename std::unordered_map<
         KeyType,
         typename std::list<CacheNode<KeyType, ValueType>*>::iterator>::iterator
@@ -104,24 +106,30 @@ class LruCachePolicy final : public CachePolicy<KeyType, ValueType> {
 
   //引用计数-1，持有者不再不使用node时调用
   void Release(CacheNode<KeyType, ValueType>* node) {
-    LockType lock_type;
-    ScopedLockImpl<LockType> lock_guard(lock_type);
+    ScopedLockImpl<LockType> lock_guard(lock_);
     Unref(node);
   }
 
-  // 定期的来进行回收（针对待释放容器中的node）
+  // 定期的来进行回收（针对待释放容器中已经没有引用的node）
   void Prune() {
-    LockType lock_type;
-    ScopedLockImpl<LockType> lock_guard(lock_type);
-    for (auto it = wait_erase_.begin(); it != wait_erase_.end(); ++it) {
-      Unref((it->second));
+    ScopedLockImpl<LockType> lock_guard(lock_);
+    for (auto it = wait_erase_.begin(); it != wait_erase_.end();) {
+      CacheNode<KeyType, ValueType>* node = it->second;
+      if (node->refs == 0) {
+        it = wait_erase_.erase(it);
+        if (destructor_) {
+          destructor_(node->key, node->value);
+        }
+        delete node;
+      } else {
+        ++it;
+      }
     }
   }
 
   // 从缓存中删除某个key对应的节点
   void Erase(const KeyType& key) {
-    LockType lock_type;
-    ScopedLockImpl<LockType> lock_guard(lock_type);
+    ScopedLockImpl<LockType> lock_guard(lock_);
     typename std::unordered_map<
         KeyType,
         typename std::list<CacheNode<KeyType, ValueType>*>::iterator>::iterator
@@ -145,12 +153,15 @@ class LruCachePolicy final : public CachePolicy<KeyType, ValueType> {
   }
   //减少一个引用计数，如果引用计数减成0，则1.调用注册的释放函数，释放节点的key和value。2.把node从待删除容器内移除并释放node，
   void Unref(CacheNode<KeyType, ValueType>* node) {
-    if (!node) {
+    if (node) {
       --node->refs;
       if (node->refs == 0) {
-        destructor_(node->key, node->value);
-        if (wait_erase_.count(node->key) > 0) {
-          wait_erase_.erase(node->key);
+        if (destructor_) {
+          destructor_(node->key, node->value);
+        }
+        const auto& iter = wait_erase_.find(node->key);
+        if (iter != wait_erase_.end() && iter->second == node) {
+          wait_erase_.erase(iter);
         }
         delete node;
         node = nullptr;
@@ -158,11 +169,9 @@ class LruCachePolicy final : public CachePolicy<KeyType, ValueType> {
     }
   }
   
-  //将node移入待释放容器
+  //将node移入待释放容器(同一个key被替换多次时只记录最新的一个)
   void MoveToEraseContainer(CacheNode<KeyType, ValueType>* node) {
-    if (wait_erase_.count(node->key) == 0) {
-      wait_erase_[node->key] = node;
-    }
+    wait_erase_[node->key] = node;
   }
   
   //将node标记为不在缓存中,放入待删容器,并引用计数减一，这个是不带锁的版本
@@ -175,6 +184,7 @@ class LruCachePolicy final : public CachePolicy<KeyType, ValueType> {
   }
 
  private:
+  LockType lock_;//缓存的锁，所有操作共用
   const uint32_t capacity_;//缓存的容量
   uint32_t cur_size_ = 0;//当前大小
   std::list<CacheNode<KeyType, ValueType>*> nodes_;//双向链表，保存缓存中的node指针，用于表明缓存顺序
@@ -15,6 +15,10 @@ const char* ByteComparator::Name() {
 int32_t ByteComparator::Compare(const char* a, const char* b) {
   return strcmp(a, b);
 }
+int32_t ByteComparator::Compare(const std::string_view& a,
+                                const std::string_view& b) {
+  return a.compare(b);
+}
 
 void ByteComparator::FindShortest(std::string& start,
                                   const std::string_view& limit) {
@@ -12,6 +12,9 @@ class Comparator {
   virtual const char* Name() = 0;
 
   virtual int32_t Compare(const char* a, const char* b) = 0;
+  // 比较不以'\0'结尾的key(例如指向block内部的string_view)
+  virtual int32_t Compare(const std::string_view& a,
+                          const std::string_view& b) = 0;
 
   virtual void FindShortest(std::string& start, const std::string_view& limit) = 0;
 
@@ -21,6 +24,8 @@ class ByteComparator final : public Comparator {
  public:
   const char* Name() override;
   int32_t Compare(const char* a, const char* b) override;
+  int32_t Compare(const std::string_view& a,
+                  const std::string_view& b) override;
   void FindShortest(std::string& start, const std::string_view& limit) override;
 };
 }  // namespace corekv
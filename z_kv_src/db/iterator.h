@@ -22,12 +22,19 @@ class Iterator {
   virtual void SeekToLast() = 0;
 
   virtual void Seek(const std::string_view& target) = 0;
+  // 点查使用，target存在时定位到target；返回false表示target一定不存在
+  // 默认和Seek一致，data block带hash索引时可以不经过二分查找
+  virtual bool SeekForGet(const std::string_view& target) {
+    Seek(target);
+    return true;
+  }
 
   virtual void Next() = 0;
 
   virtual void Prev() = 0;
   virtual std::string_view key() const = 0;
-  virtual std::string value() = 0;
+  // 返回的数据指向迭代器持有的block，只在迭代器移动之前有效
+  virtual std::string_view value() const = 0;
 
   virtual DBStatus status() const = 0;
   using CleanupFunction = void (*)(void* arg1, void* arg2);
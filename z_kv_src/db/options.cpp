@@ -0,0 +1,72 @@
+#include "options.h"
+
+#include <algorithm>
+
+#include "../filter/blocked_bloomfilter.h"
+#include "../filter/bloomfilter.h"
+#include "../filter/xor_filter.h"
+namespace z_kv {
+namespace {
+template <typename T>
+T LevelValue(const std::vector<T>& values, int32_t level, T default_value) {
+  if (values.empty()) {
+    return default_value;
+  }
+  return values[std::min<size_t>(level, values.size() - 1)];
+}
+constexpr int32_t kDefaultBitsPerKey = 10;
+// xor过滤器每个filter覆盖64KB的data block，固定开销可以忽略
+constexpr uint32_t kXorFilterBaseLg = 16;
+std::shared_ptr<FilterPolicy> NewFilterPolicy(FilterPolicyType type,
+                                              int32_t bits_per_key) {
+  switch (type) {
+    case kBlockedBloomFilterPolicy:
+      return std::make_shared<BlockedBloomFilter>(bits_per_key);
+    case kXorFilterPolicy:
+      return std::make_shared<XorFilter>();
+    case kBloomFilterPolicy:
+    default:
+      return std::make_shared<BloomFilter>(bits_per_key);
+  }
+}
+}  // namespace
+
+std::shared_ptr<FilterPolicy> NewFilterPolicyByName(
+    const std::string_view& name) {
+  if (name == BloomFilter::kName) {
+    return NewFilterPolicy(kBloomFilterPolicy, kDefaultBitsPerKey);
+  }
+  if (name == BlockedBloomFilter::kName) {
+    return NewFilterPolicy(kBlockedBloomFilterPolicy, kDefaultBitsPerKey);
+  }
+  if (name == XorFilter::kName) {
+    return NewFilterPolicy(kXorFilterPolicy, kDefaultBitsPerKey);
+  }
+  return nullptr;
+}
+Options Options::ForLevel(int32_t level) const {
+  Options options = *this;
+  if (level < 0) {
+    return options;
+  }
+  options.block_compress_type =
+      LevelValue(compression_per_level, level, block_compress_type);
+  if (!LevelValue(compression_dict_per_level, level, true)) {
+    options.compression_dict_size = 0;
+  }
+  options.block_size = LevelValue(block_size_per_level, level, block_size);
+  if (!bloom_bits_per_key_per_level.empty() || !filter_type_per_level.empty()) {
+    // 每层使用单独的过滤器对象，读取时过滤器的参数从sst中恢复
+    const int32_t bits_per_key =
+        LevelValue(bloom_bits_per_key_per_level, level, kDefaultBitsPerKey);
+    const FilterPolicyType type =
+        LevelValue(filter_type_per_level, level, kBloomFilterPolicy);
+    options.filter_policy =
+        bits_per_key > 0 ? NewFilterPolicy(type, bits_per_key) : nullptr;
+    if (options.filter_policy && type == kXorFilterPolicy) {
+      options.filter_base_lg = std::max(options.filter_base_lg, kXorFilterBaseLg);
+    }
+  }
+  return options;
+}
+}  // namespace corekv
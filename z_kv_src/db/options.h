@@ -3,18 +3,50 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "../cache/cache.h"
 #include "table/data_block.h"
 namespace z_kv {
 class FilterPolicy;
 class Comparator;
+class ThreadPool;
 }
 namespace z_kv {
   
 enum  BlockCompressType  {
   kNonCompress = 0x0,
-  kSnappyCompression = 0x1
+  // 没有链接snappy库，写入时会使用内置的LZ压缩代替
+  kSnappyCompression = 0x1,
+  // 内置的LZ压缩(utils/lz_compress.h)
+  kLZCompression = 0x2,
+  // 基于sst字典的LZ压缩，只作为block的类型标记，由compression_dict_size开启
+  kLZDictCompression = 0x3
+};
+
+// 按层选择的过滤器类型
+enum FilterPolicyType {
+  // 标准布隆过滤器(filter/bloomfilter.h)
+  kBloomFilterPolicy = 0x0,
+  // 按cache line分块的布隆过滤器(filter/blocked_bloomfilter.h)
+  kBlockedBloomFilterPolicy = 0x1,
+  // 静态的xor8过滤器(filter/xor_filter.h)，不使用bits_per_key
+  kXorFilterPolicy = 0x2
+};
+// 按sst中记录的过滤器名字创建查询用的policy(查询需要的参数保存在过滤器数据中)，
+// 未知的名字返回nullptr
+std::shared_ptr<FilterPolicy> NewFilterPolicyByName(
+    const std::string_view& name);
+
+// block trailer中的校验算法，记录在footer中，整个sst使用同一种
+enum ChecksumType {
+  // 不校验，trailer中的校验值为0
+  kNoChecksum = 0x0,
+  // crc32c(默认，旧版本的sst都是这种)
+  kCRC32cChecksum = 0x1,
+  // hash_util::Hash64的低32位，没有硬件crc指令时比查表的crc32c快很多
+  kHash64Checksum = 0x2
 };
 
 //构建sst时需要设置的属性
@@ -23,12 +55,68 @@ struct Options {
   uint32_t block_size = 4 * 1024;
   // 16个entry来构建一个restart
   uint32_t block_restart_interval = 16;
+  // data block内hash索引的负载(key个数/bucket个数，例如0.75)，0表示不构建
+  // 点查时通过hash索引直接定位到entry，不需要二分查找restart
+  double data_block_hash_ratio = 0;
   // 最多的层数，默认是7
   uint32_t max_level_num = 7;
   // kv分离的阈值(默认1024k)
   uint32_t max_key_value_split_threshold = 1024;
   // 默认不会进行压缩
   BlockCompressType block_compress_type = BlockCompressType::kNonCompress;
+  // 压缩字典的大小，0表示不使用字典(只对LZ压缩生效)
+  // 开启后每个sst先缓存一部分data block作为样本训练字典，所有data block基于字典压缩
+  uint32_t compression_dict_size = 0;
+  // 训练字典使用的样本数据量
+  uint32_t compression_dict_sample_size = 128 * 1024;
+  // 压缩线程池，设置后data block的压缩和crc计算交给线程池并行执行，
+  // 构建线程只负责按顺序写入文件，可以和其他sst的构建共用
+  std::shared_ptr<ThreadPool> compress_pool = nullptr;
+  // 使用压缩线程池时，最多有多少个block在排队等待写入
+  uint32_t compress_pending_blocks = 16;
+  // index和filter分区存储(适合大sst)：顶层索引常驻内存，分区通过block cache按需加载
+  bool partition_index_and_filters = false;
+  // index分区的目标大小，每个index分区对应一个filter分区
+  uint32_t metadata_block_size = 4096;
+  // 每个filter覆盖2^filter_base_lg字节的data block，
+  // xor这类静态过滤器每个filter有固定开销，ForLevel中会调大
+  uint32_t filter_base_lg = 11;
+  // block的校验算法
+  ChecksumType checksum_type = kCRC32cChecksum;
+  // 读取sst时使用mmap(适合内存大于数据量、以读为主的场景)，
+  // 未压缩的block直接引用映射中的数据，不拷贝也不进入block_cache
+  bool use_mmap_reads = false;
+  // flush和compaction的输入输出使用O_DIRECT，大量的顺序读写不经过页缓存，
+  // 避免把前台读取的热数据挤出去。
+  // 由TableBuilder::NewFileWriter和TableCache::NewCompactionReader使用
+  bool use_direct_io_for_flush_and_compaction = false;
+  // flush和compaction输出文件的写缓冲区个数(FileWriterOptions::buffer_num)，
+  // 大于1时由后台线程写盘，TableBuilder构建block和写盘可以重叠
+  uint32_t table_write_buffer_num = 1;
+  // 写sst时每写出多少字节让内核开始回写，避免Sync时集中刷出大量脏页，0表示关闭
+  // 这两项由TableBuilder::NewFileWriter使用
+  uint64_t bytes_per_sync = 0;
+  // 写sst时每次预分配的空间(FileWriterOptions::preallocate_size)，
+  // Close时截断到实际大小，0表示不预分配。由TableBuilder::NewFileWriter使用
+  uint64_t table_preallocate_size = 4 * 1024 * 1024;
+  // 打开的sst检测到顺序读取(例如迭代器扫描)时的最大预读大小，0表示关闭
+  // table cache打开的文件关闭了内核预读，顺序扫描依赖这里的预读
+  uint32_t max_auto_readahead_size = 1024 * 1024;
+  // compaction输入文件的固定预读大小(FileReader::SetReadaheadBuffer)，
+  // 由TableCache::NewCompactionReader使用，0表示不使用预读缓冲区
+  uint32_t compaction_readahead_size = 2 * 1024 * 1024;
+  // 按层设置的属性：为空时使用上面的全局设置，层数超过长度时使用最后一个
+  // L0/L1的数据很快会被重写，可以不压缩；最后一层保存了绝大部分数据，适合重度压缩
+  std::vector<BlockCompressType> compression_per_level;
+  // 每层是否使用压缩字典(字典大小还是由compression_dict_size决定)
+  std::vector<bool> compression_dict_per_level;
+  std::vector<uint32_t> block_size_per_level;
+  // 每层布隆过滤器每个key占的bit数，0表示该层不使用过滤器
+  std::vector<int32_t> bloom_bits_per_key_per_level;
+  // 每层使用的过滤器类型，只设置类型时每个key默认10bit
+  std::vector<FilterPolicyType> filter_type_per_level;
+  // 返回level层实际使用的属性，TableBuilder根据输出层调用
+  Options ForLevel(int32_t level) const;
   // 过滤器
   std::shared_ptr<FilterPolicy> filter_policy = nullptr;
   //key的比较器，使用字节序
@@ -4,18 +4,59 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/errno.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <memory>
+#include <vector>
 
 #include "../logger/log.h"
+#include "../utils/mutex.h"
+#include "../utils/thread_pool.h"
+#include "io_uring.h"
 namespace z_kv {
+namespace {
+// 不支持io_uring时批量读使用的线程数
+constexpr uint32_t kMultiReadThreads = 8;
+std::atomic<bool> use_io_uring{true};
+// pread可能被信号打断或者只读到一部分，循环直到读满，读到文件末尾算失败
+DBStatus PreadFully(int fd, uint64_t offset, size_t n, char* buf) {
+  while (n > 0) {
+    const ssize_t ret = pread(fd, buf, n, static_cast<off_t>(offset));
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      LOG(z_kv::LogLevel::ERROR, "pread failed, ret = [%zd], code = [%d]", ret,
+          errno);
+      return Status::kReadFileFailed;
+    }
+    buf += ret;
+    offset += ret;
+    n -= ret;
+  }
+  return Status::kSuccess;
+}
+ThreadPool* MultiReadPool() {
+  // 不释放，避免进程退出时和仍在使用的线程发生析构顺序问题
+  static ThreadPool* pool = new ThreadPool(kMultiReadThreads);
+  return pool;
+}
+}  // namespace
 //按传入路径打开sst文件,没有就重新创建
-FileWriter::FileWriter(const std::string& path_name, bool append) {
+FileWriter::FileWriter(const std::string& path_name, bool append,
+                       bool direct_io)
+    : FileWriter(path_name, FileWriterOptions{append, direct_io}) {}
+FileWriter::FileWriter(const std::string& path_name,
+                       const FileWriterOptions& options) {
+  const bool append = options.append;
+  const bool direct_io = options.direct_io;
   std::string::size_type separator_pos = path_name.rfind('/');
   if (separator_pos == std::string::npos) {
     //那说明是当前路径
@@ -26,16 +67,49 @@ FileWriter::FileWriter(const std::string& path_name, bool append) {
     }
   }
   int32_t mode = O_CREAT | O_WRONLY;
+  recycle_ = options.recycle && !append;
   //判断是否为追加模式
   if (append) {
     mode |= O_APPEND;
-  } else {
+  } else if (!recycle_) {
     mode |= O_TRUNC;
   }
   LOG(WARN,"path=%s", path_name.c_str());
-  fd_ = ::open(path_name.data(), mode, 0644);
+  if (direct_io && !append) {
+    fd_ = ::open(path_name.data(), mode | O_DIRECT, 0644);
+    // tmpfs等文件系统不支持O_DIRECT，打开时返回EINVAL
+    direct_io_ = fd_ != -1;
+  }
+  if (fd_ == -1) {
+    fd_ = ::open(path_name.data(), mode, 0644);
+  }
   //验证是否创建成功
   assert(::access(path_name.c_str(), F_OK) == 0);
+  bytes_per_sync_ = options.bytes_per_sync;
+  preallocate_size_ = options.preallocate_size;
+  if (fd_ > -1) {
+    struct stat file_stat;
+    if (fstat(fd_, &file_stat) == 0) {
+      preallocated_end_ = file_stat.st_size;
+    }
+    if (append) {
+      write_offset_ = synced_offset_ = preallocated_end_;
+    }
+  }
+  if (options.buffer_num > 1 && fd_ > -1) {
+    // 额外的缓冲区也按direct io的要求对齐
+    for (uint32_t i = 1; i < options.buffer_num; ++i) {
+      void* buf = nullptr;
+      if (posix_memalign(&buf, kDirectIoAlignment, kMaxFileBufferSize) != 0) {
+        break;
+      }
+      extra_buffers_.emplace_back(static_cast<char*>(buf), free);
+      free_buffers_.push_back(static_cast<char*>(buf));
+    }
+    if (!free_buffers_.empty()) {
+      io_thread_ = std::thread(&FileWriter::IoLoop, this);
+    }
+  }
 }
 //对sst文件进行追加数据操作
 DBStatus FileWriter::Append(const char* data, int32_t len) {
@@ -43,6 +117,28 @@ DBStatus FileWriter::Append(const char* data, int32_t len) {
   if (len == 0 || !data) {
     return Status::kSuccess;
   }
+  if (direct_io_ || IsAsync()) {
+    // direct io只能从对齐的缓冲区写出，异步模式由io线程写出缓冲区，
+    // 大块数据也要经过缓冲区
+    while (len > 0) {
+      const int32_t copy_size =
+          std::min<int32_t>(len, kMaxFileBufferSize - current_pos_);
+      memcpy(buffer_ + current_pos_, data, copy_size);
+      data += copy_size;
+      len -= copy_size;
+      current_pos_ += copy_size;
+      if (current_pos_ == static_cast<int32_t>(kMaxFileBufferSize)) {
+        DBStatus status = IsAsync() ? SubmitBuffer() : FlushAligned(false);
+        if (status != Status::kSuccess) {
+          return status;
+        }
+        if (!direct_io_ && !IsAsync()) {
+          return Append(data, len);
+        }
+      }
+    }
+    return Status::kSuccess;
+  }
   //计算实际可写入buffer的长度
   int32_t remain_size =
       std::min<int32_t>(len, kMaxFileBufferSize - current_pos_);
@@ -77,6 +173,14 @@ DBStatus FileWriter::Append(const char* data, int32_t len) {
 }
 // 当缓冲区不满但需落盘时就执行手动刷盘
 DBStatus FileWriter::FlushBuffer() {
+  // 之前提交的缓冲区写完之后才能写当前的缓冲区
+  DBStatus status = WaitForIo();
+  if (status != Status::kSuccess) {
+    return status;
+  }
+  if (direct_io_) {
+    return FlushAligned(false);
+  }
   if (current_pos_ > 0) {
     int ret = Writen(buffer_, current_pos_);
     current_pos_ = 0;
@@ -86,6 +190,56 @@ DBStatus FileWriter::FlushBuffer() {
   }
   return Status::kSuccess;
 }
+DBStatus FileWriter::FlushAligned(bool pad) {
+  const uint32_t aligned_size = current_pos_ & ~(kDirectIoAlignment - 1);
+  uint32_t write_size = aligned_size;
+  if (pad && write_size < static_cast<uint32_t>(current_pos_)) {
+    // 尾部补0凑满一个对齐块，Close时再截断到实际大小
+    write_size = aligned_size + kDirectIoAlignment;
+    memset(buffer_ + current_pos_, 0, write_size - current_pos_);
+  }
+  MaybePreallocate(file_offset_ + write_size);
+  const char* ptr = buffer_;
+  uint32_t left = write_size;
+  while (left > 0) {
+    const off_t offset = static_cast<off_t>(file_offset_ + (ptr - buffer_));
+    const ssize_t ret = pwrite(fd_, ptr, left, offset);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0 && errno == EINVAL) {
+      // 部分文件系统打开时接受O_DIRECT，写入时才报错，退化为普通写，
+      // 从缓冲区的起始位置重新写出
+      DisableDirectIo();
+      const ssize_t written = Writen(buffer_, current_pos_);
+      current_pos_ = 0;
+      return written == -1 ? Status::kWriteFileFailed : Status::kSuccess;
+    }
+    if (ret <= 0) {
+      LOG(z_kv::LogLevel::ERROR, "pwrite failed, code = [%d]", errno);
+      return Status::kWriteFileFailed;
+    }
+    ptr += ret;
+    left -= ret;
+  }
+  // 已经完整写出的对齐块从缓冲区中移除，不足一个对齐块的尾部留下来，
+  // 补0写出的那部分下次会被覆盖
+  memmove(buffer_, buffer_ + aligned_size, current_pos_ - aligned_size);
+  current_pos_ -= aligned_size;
+  file_offset_ += aligned_size;
+  return Status::kSuccess;
+}
+void FileWriter::DisableDirectIo() {
+  const int flags = fcntl(fd_, F_GETFL);
+  if (flags != -1) {
+    fcntl(fd_, F_SETFL, flags & ~O_DIRECT);
+  }
+  // 之后按普通模式从当前的逻辑末尾继续追加
+  lseek(fd_, static_cast<off_t>(file_offset_), SEEK_SET);
+  write_offset_ = synced_offset_ = file_offset_;
+  direct_io_ = false;
+  LOG(WARN, "direct io not supported, fallback to buffered io");
+}
 ssize_t /* Write "n" bytes to a descriptor. */
 //把缓冲区的内容写入sst文件
 FileWriter::Writen(const char* data, int len) {
@@ -93,6 +247,7 @@ FileWriter::Writen(const char* data, int len) {
   ssize_t nwritten;  //单次调用write()写入的字节数
   const char* ptr;   // write的缓冲区
 
+  MaybePreallocate(write_offset_ + len);
   ptr = data;  //把传参进来的write要写的缓冲区备份一份
   nleft = len;  //还剩余需要写的字节数初始化为总共需要写的字节数
   while (nleft > 0) {  //循环写，直到全部写入
@@ -107,55 +262,528 @@ FileWriter::Writen(const char* data, int len) {
     nleft -=nwritten;  //还剩余需要写的字节数=现在还剩余需要写的字节数-这次已经写的字节数
     ptr += nwritten;  //下次开始写的缓冲区位置=缓冲区现在的位置右移已经写了的字节数大小
   }
-  return current_pos_;  //返回已经写了的字节数
+  write_offset_ += len;
+  MaybeRangeSync();
+  return len;  //返回已经写了的字节数
 }
 //关闭缓冲区
-void FileWriter::Sync() {
-  FlushBuffer();
-  if (fd_ > -1) {
-    fsync(fd_);
+void FileWriter::MaybeRangeSync() {
+#ifdef SYNC_FILE_RANGE_WRITE
+  // direct io不产生脏页
+  if (bytes_per_sync_ == 0 || direct_io_ ||
+      write_offset_ - synced_offset_ < bytes_per_sync_) {
+    return;
+  }
+  // 只发起回写不等待完成，之后的fdatasync只需要处理最后一段脏页
+  sync_file_range(fd_, static_cast<off_t>(synced_offset_),
+                  static_cast<off_t>(write_offset_ - synced_offset_),
+                  SYNC_FILE_RANGE_WRITE);
+  synced_offset_ = write_offset_;
+#endif
+}
+void FileWriter::MaybePreallocate(uint64_t end) {
+#ifdef FALLOC_FL_KEEP_SIZE
+  if (preallocate_size_ == 0 || end <= preallocated_end_) {
+    return;
+  }
+  const uint64_t new_end =
+      (end + preallocate_size_ - 1) / preallocate_size_ * preallocate_size_;
+  // KEEP_SIZE：只分配空间不改变文件大小，读者看到的还是实际写入的数据
+  if (fallocate(fd_, FALLOC_FL_KEEP_SIZE,
+                static_cast<off_t>(preallocated_end_),
+                static_cast<off_t>(new_end - preallocated_end_)) != 0) {
+    LOG(WARN, "fallocate failed, code = [%d], disable preallocation", errno);
+    preallocate_size_ = 0;
+    return;
+  }
+  preallocated_end_ = new_end;
+#endif
+}
+DBStatus FileWriter::SubmitBuffer() {
+  ScopedLockImpl<MutexLock> lock(io_mutex_);
+  if (io_status_ != Status::kSuccess) {
+    return io_status_;
+  }
+  io_tasks_.push_back({buffer_, static_cast<uint32_t>(current_pos_),
+                       file_offset_});
+  if (direct_io_) {
+    // direct io的写入偏移由这里分配，预分配也在这里做，
+    // 普通写在io线程的Writen中预分配
+    MaybePreallocate(file_offset_ + current_pos_);
+    // 提交的缓冲区总是满的，下一个缓冲区从对齐的位置开始
+    file_offset_ += current_pos_;
   }
+  io_cv_.Signal();
+  while (free_buffers_.empty()) {
+    done_cv_.Wait();
+  }
+  buffer_ = free_buffers_.back();
+  free_buffers_.pop_back();
+  current_pos_ = 0;
+  return io_status_;
+}
+DBStatus FileWriter::WaitForIo() {
+  if (!IsAsync()) {
+    return Status::kSuccess;
+  }
+  ScopedLockImpl<MutexLock> lock(io_mutex_);
+  while (!io_tasks_.empty() || io_running_) {
+    done_cv_.Wait();
+  }
+  return io_status_;
+}
+void FileWriter::StopIoThread() {
+  if (!IsAsync()) {
+    return;
+  }
+  {
+    ScopedLockImpl<MutexLock> lock(io_mutex_);
+    stop_io_ = true;
+    io_cv_.Signal();
+  }
+  io_thread_.join();
+}
+void FileWriter::IoLoop() {
+  ScopedLockImpl<MutexLock> lock(io_mutex_);
+  while (true) {
+    while (io_tasks_.empty() && !stop_io_) {
+      io_cv_.Wait();
+    }
+    // 退出前写完已经提交的缓冲区
+    if (io_tasks_.empty()) {
+      break;
+    }
+    const IoTask task = io_tasks_.front();
+    io_tasks_.pop_front();
+    io_running_ = true;
+    const bool direct_io = direct_io_;
+    lock.UnLock();
+    bool ok = true;
+    if (direct_io) {
+      const char* ptr = task.buf;
+      uint32_t left = task.size;
+      while (left > 0) {
+        const ssize_t ret =
+            pwrite(fd_, ptr, left, task.offset + (ptr - task.buf));
+        if (ret < 0 && errno == EINTR) {
+          continue;
+        }
+        if (ret < 0 && errno == EINVAL) {
+          // 写入时才报不支持O_DIRECT，清掉标记后按原来的偏移重试，
+          // 之后的写入仍然按对齐块进行，Close时会截断到实际大小
+          const int flags = fcntl(fd_, F_GETFL);
+          if (flags != -1 && (flags & O_DIRECT) &&
+              fcntl(fd_, F_SETFL, flags & ~O_DIRECT) == 0) {
+            LOG(WARN, "direct io not supported, fallback to buffered io");
+            continue;
+          }
+        }
+        if (ret <= 0) {
+          LOG(z_kv::LogLevel::ERROR, "pwrite failed, code = [%d]", errno);
+          ok = false;
+          break;
+        }
+        ptr += ret;
+        left -= ret;
+      }
+    } else {
+      ok = Writen(task.buf, task.size) != -1;
+    }
+    lock.Lock();
+    if (!ok && io_status_ == Status::kSuccess) {
+      io_status_ = Status::kWriteFileFailed;
+    }
+    free_buffers_.push_back(task.buf);
+    io_running_ = false;
+    done_cv_.SignalAll();
+  }
+}
+DBStatus FileWriter::Sync() {
+  DBStatus status = WaitForIo();
+  if (status != Status::kSuccess) {
+    return status;
+  }
+  status = direct_io_ ? FlushAligned(true) : FlushBuffer();
+  if (status != Status::kSuccess) {
+    return status;
+  }
+  if (fd_ == -1) {
+    return Status::kWriteFileFailed;
+  }
+  // 文件大小变化时fdatasync也会写入元数据，覆盖写复用的文件时只需要刷数据
+  while (fdatasync(fd_) != 0) {
+    if (errno != EINTR) {
+      LOG(z_kv::LogLevel::ERROR, "fdatasync failed, code = [%d]", errno);
+      return Status::kWriteFileFailed;
+    }
+  }
+  return Status::kSuccess;
 }
 //关闭文件
 void FileWriter::Close() {
+  WaitForIo();
+  StopIoThread();
+  if (direct_io_ && fd_ > -1) {
+    // 补0写出最后一个对齐块，然后截断到实际大小
+    const uint64_t file_size = file_offset_ + current_pos_;
+    if (FlushAligned(true) == Status::kSuccess && direct_io_) {
+      ftruncate(fd_, static_cast<off_t>(file_size));
+      current_pos_ = 0;
+    }
+  }
   FlushBuffer();
+  // 释放预分配而没有用到的空间，复用的文件还要去掉原来的数据
+  if (!direct_io_ && fd_ > -1 &&
+      (recycle_ || preallocated_end_ > write_offset_)) {
+    ftruncate(fd_, static_cast<off_t>(write_offset_));
+  }
   if (fd_ > -1) {
     close(fd_);
     fd_ = -1;
   }
 }
-FileWriter::~FileWriter() {}
+FileWriter::~FileWriter() { StopIoThread(); }
 
 
 
 
 // file_reader
 FileReader::~FileReader() {
+  if (mmap_base_ != nullptr) {
+    munmap(mmap_base_, mmap_size_);
+    mmap_base_ = nullptr;
+  }
   if (fd_ > -1) {
     close(fd_);
     fd_ = -1;
   }
 }
-FileReader::FileReader(const std::string& path_name) {
+FileReader::FileReader(const std::string& path_name, bool use_mmap,
+                       bool direct_io) {
   if (::access(path_name.c_str(), F_OK) != 0) {
     LOG(z_kv::LogLevel::ERROR, "path_name:%s don't existed!",
         path_name.data());
-  } else {
+    return;
+  }
+  if (direct_io && !use_mmap) {
+    fd_ = open(path_name.data(), O_RDONLY | O_DIRECT);
+    direct_io_.store(fd_ != -1, std::memory_order_relaxed);
+  }
+  if (fd_ == -1) {
     fd_ = open(path_name.data(), O_RDONLY);
   }
+  if (!use_mmap || fd_ == -1) {
+    return;
+  }
+  struct ::stat file_stat;
+  if (::fstat(fd_, &file_stat) != 0 || file_stat.st_size == 0) {
+    return;
+  }
+  void* base =
+      ::mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+  if (base == MAP_FAILED) {
+    LOG(z_kv::LogLevel::ERROR, "mmap %s failed, code = [%d]",
+        path_name.c_str(), errno);
+    return;
+  }
+  mmap_base_ = static_cast<char*>(base);
+  mmap_size_ = file_stat.st_size;
 }
 DBStatus FileReader::Read(uint64_t offset, size_t n,
                           std::string* result) const {
   if (!result) {
     return Status::kInvalidObject;
   }
+  if (mmap_base_ != nullptr) {
+    if (offset > mmap_size_ || n > mmap_size_ - offset) {
+      return Status::kReadFileFailed;
+    }
+    result->resize(n);
+    memcpy(result->data(), mmap_base_ + offset, n);
+    return Status::kSuccess;
+  }
   if (fd_ == -1) {
     LOG(z_kv::LogLevel::ERROR, "Invalid Socket");
     return Status::kInterupt;
   }
-  pread(fd_, result->data(), n, static_cast<off_t>(offset));
+  if (readahead_buffer_) {
+    return ReadFromBuffer(offset, n, result->data());
+  }
+  MaybeReadahead(offset, n);
+  if (direct_io_.load(std::memory_order_relaxed)) {
+    return DirectRead(offset, n, result->data());
+  }
+  return PreadFully(fd_, offset, n, result->data());
+}
+void FileReader::EnableAutoReadahead(size_t max_size) {
+  max_readahead_size_ = max_size;
+}
+void FileReader::SetReadaheadBuffer(size_t size) {
+  if (mmap_base_ != nullptr) {
+    // 映射的数据由内核预读
+    Advise(kSequential);
+    return;
+  }
+  size = (size + kDirectIoAlignment - 1) & ~(kDirectIoAlignment - 1);
+  void* aligned = nullptr;
+  if (size == 0 || posix_memalign(&aligned, kDirectIoAlignment, size) != 0) {
+    readahead_buffer_.reset();
+    readahead_buffer_size_ = 0;
+    return;
+  }
+  readahead_buffer_.reset(static_cast<char*>(aligned));
+  readahead_buffer_size_ = size;
+  buffer_offset_ = 0;
+  buffer_len_ = 0;
+}
+void FileReader::MaybeReadahead(uint64_t offset, size_t n) const {
+  // direct io不经过页缓存，WILLNEED没有意义
+  if (max_readahead_size_ == 0 || direct_io_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  const uint64_t end = offset + n;
+  if (last_read_end_.exchange(end, std::memory_order_relaxed) != offset) {
+    // 不是接着上一次读取，重新开始检测
+    readahead_size_.store(0, std::memory_order_relaxed);
+    readahead_end_.store(0, std::memory_order_relaxed);
+    return;
+  }
+  // 预读的数据还剩一半以上时不需要再发起预读
+  uint64_t size = readahead_size_.load(std::memory_order_relaxed);
+  const uint64_t readahead_end = readahead_end_.load(std::memory_order_relaxed);
+  if (end + size / 2 < readahead_end) {
+    return;
+  }
+  size = size == 0 ? kInitReadaheadSize : size * 2;
+  if (size > max_readahead_size_) {
+    size = max_readahead_size_;
+  }
+  const uint64_t start = readahead_end > end ? readahead_end : end;
+  Advise(kWillNeed, start, size);
+  readahead_size_.store(size, std::memory_order_relaxed);
+  readahead_end_.store(start + size, std::memory_order_relaxed);
+}
+DBStatus FileReader::ReadFromBuffer(uint64_t offset, size_t n,
+                                    char* result) const {
+  if (offset >= buffer_offset_ && offset + n <= buffer_offset_ + buffer_len_) {
+    memcpy(result, readahead_buffer_.get() + (offset - buffer_offset_), n);
+    return Status::kSuccess;
+  }
+  const bool direct_io = direct_io_.load(std::memory_order_relaxed);
+  const uint64_t start =
+      direct_io ? offset & ~static_cast<uint64_t>(kDirectIoAlignment - 1)
+                : offset;
+  if (offset + n - start > readahead_buffer_size_) {
+    // 比缓冲区还大的读取直接读
+    return direct_io ? DirectRead(offset, n, result)
+                     : PreadFully(fd_, offset, n, result);
+  }
+  // 一次读满缓冲区，读到文件末尾时只要覆盖了本次读取就可以
+  buffer_len_ = 0;
+  char* buf = readahead_buffer_.get();
+  size_t done = 0;
+  while (start + done < offset + n) {
+    const ssize_t ret = pread(fd_, buf + done, readahead_buffer_size_ - done,
+                              static_cast<off_t>(start + done));
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0 && errno == EINVAL && direct_io) {
+      // 由DirectRead处理O_DIRECT不支持的情况
+      return DirectRead(offset, n, result);
+    }
+    if (ret <= 0) {
+      LOG(z_kv::LogLevel::ERROR, "pread failed, ret = [%zd], code = [%d]", ret,
+          errno);
+      return Status::kReadFileFailed;
+    }
+    done += ret;
+  }
+  buffer_offset_ = start;
+  buffer_len_ = done;
+  memcpy(result, buf + (offset - start), n);
+  return Status::kSuccess;
+}
+DBStatus FileReader::DirectRead(uint64_t offset, size_t n, char* result) const {
+  static constexpr uint64_t kMask = kDirectIoAlignment - 1;
+  const uint64_t begin = offset & ~kMask;
+  const uint64_t end = (offset + n + kMask) & ~kMask;
+  const size_t size = end - begin;
+  void* aligned = nullptr;
+  if (posix_memalign(&aligned, kDirectIoAlignment, size) != 0) {
+    return Status::kReadFileFailed;
+  }
+  std::unique_ptr<char, decltype(&free)> buf(static_cast<char*>(aligned),
+                                             &free);
+  // 对齐的范围可能超过文件末尾，读到[offset, offset+n)就够了
+  size_t done = 0;
+  while (begin + done < offset + n) {
+    const ssize_t ret = pread(fd_, buf.get() + done, size - done,
+                              static_cast<off_t>(begin + done));
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0 && errno == EINVAL) {
+      // 文件系统不支持O_DIRECT，关闭之后按普通方式读取
+      const int flags = fcntl(fd_, F_GETFL);
+      if (flags != -1) {
+        fcntl(fd_, F_SETFL, flags & ~O_DIRECT);
+      }
+      direct_io_.store(false, std::memory_order_relaxed);
+      LOG(WARN, "direct io not supported, fallback to buffered io");
+      return PreadFully(fd_, offset, n, result);
+    }
+    if (ret <= 0) {
+      LOG(z_kv::LogLevel::ERROR, "pread failed, ret = [%zd], code = [%d]", ret,
+          errno);
+      return Status::kReadFileFailed;
+    }
+    done += ret;
+  }
+  memcpy(result, buf.get() + (offset - begin), n);
+  return Status::kSuccess;
+}
+DBStatus FileReader::Read(uint64_t offset, size_t n, std::string_view* result,
+                          std::string* scratch) const {
+  if (!result || !scratch) {
+    return Status::kInvalidObject;
+  }
+  if (mmap_base_ == nullptr) {
+    scratch->resize(n);
+    DBStatus s = Read(offset, n, scratch);
+    if (s == Status::kSuccess) {
+      *result = *scratch;
+    }
+    return s;
+  }
+  if (offset > mmap_size_ || n > mmap_size_ - offset) {
+    return Status::kReadFileFailed;
+  }
+  MaybeReadahead(offset, n);
+  *result = std::string_view(mmap_base_ + offset, n);
   return Status::kSuccess;
 }
+void FileReader::EnableIoUring(bool enable) {
+  use_io_uring.store(enable, std::memory_order_relaxed);
+}
+DBStatus FileReader::MultiRead(ReadRequest* requests, size_t n) {
+  // mmap和无效的文件直接在当前线程完成，其余的需要真正的io
+  // direct io需要对齐的缓冲区，不走io_uring，交给线程池读取
+  std::vector<size_t> pending;
+  pending.reserve(n);
+  std::vector<size_t> direct;
+  for (size_t i = 0; i < n; ++i) {
+    ReadRequest& request = requests[i];
+    if (!request.reader || !request.result) {
+      request.status = Status::kInvalidObject;
+    } else if (request.reader->IsMmap() || request.reader->fd_ == -1) {
+      request.status =
+          request.reader->Read(request.offset, request.len, request.result);
+    } else if (request.reader->IsDirectIo()) {
+      request.result->resize(request.len);
+      direct.push_back(i);
+    } else {
+      request.result->resize(request.len);
+      pending.push_back(i);
+    }
+  }
+  IoUring* ring = use_io_uring.load(std::memory_order_relaxed)
+                      ? IoUring::ThreadLocal()
+                      : nullptr;
+  if (pending.size() > 1 && ring != nullptr) {
+    std::vector<IoUring::ReadOp> ops(pending.size());
+    for (size_t i = 0; i < pending.size(); ++i) {
+      ReadRequest& request = requests[pending[i]];
+      ops[i].fd = request.reader->fd_;
+      ops[i].offset = request.offset;
+      ops[i].len = request.len;
+      ops[i].buf = request.result->data();
+    }
+    if (ring->ReadAll(ops.data(), ops.size())) {
+      for (size_t i = 0; i < pending.size(); ++i) {
+        ReadRequest& request = requests[pending[i]];
+        const ssize_t res = ops[i].res;
+        if (res < 0) {
+          LOG(z_kv::LogLevel::ERROR, "io_uring read failed, code = [%zd]",
+              -res);
+          request.status = Status::kReadFileFailed;
+        } else if (static_cast<size_t>(res) < request.len) {
+          // 短读：剩余部分同步读取
+          request.status = PreadFully(
+              request.reader->fd_, request.offset + res, request.len - res,
+              request.result->data() + res);
+        } else {
+          request.status = Status::kSuccess;
+        }
+      }
+      pending.clear();
+    }
+  }
+  pending.insert(pending.end(), direct.begin(), direct.end());
+  if (pending.size() > 1) {
+    // 退化为线程池并行pread，调用线程也参与读取
+    MutexLock mutex;
+    CondVar done_cv(&mutex);
+    size_t remaining = pending.size() - 1;
+    for (size_t i = 1; i < pending.size(); ++i) {
+      ReadRequest* request = &requests[pending[i]];
+      MultiReadPool()->Schedule([request, &mutex, &done_cv, &remaining]() {
+        request->status = request->reader->Read(request->offset, request->len,
+                                                request->result);
+        ScopedLockImpl<MutexLock> lock_guard(mutex);
+        if (--remaining == 0) {
+          done_cv.Signal();
+        }
+      });
+    }
+    ReadRequest& first = requests[pending[0]];
+    first.status = first.reader->Read(first.offset, first.len, first.result);
+    ScopedLockImpl<MutexLock> lock_guard(mutex);
+    while (remaining > 0) {
+      done_cv.Wait();
+    }
+  } else if (pending.size() == 1) {
+    ReadRequest& request = requests[pending[0]];
+    request.status =
+        request.reader->Read(request.offset, request.len, request.result);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (requests[i].status != Status::kSuccess) {
+      return requests[i].status;
+    }
+  }
+  return Status::kSuccess;
+}
+void FileReader::Advise(AccessPattern pattern, uint64_t offset,
+                        uint64_t length) const {
+  if (fd_ == -1) {
+    return;
+  }
+  if (mmap_base_ == nullptr) {
+    // 没有映射时对页缓存做同样的提示
+    static constexpr int kFadvise[] = {POSIX_FADV_NORMAL, POSIX_FADV_RANDOM,
+                                       POSIX_FADV_SEQUENTIAL,
+                                       POSIX_FADV_WILLNEED};
+    posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(length),
+                  kFadvise[pattern]);
+    return;
+  }
+  if (offset >= mmap_size_) {
+    return;
+  }
+  if (length == 0 || length > mmap_size_ - offset) {
+    length = mmap_size_ - offset;
+  }
+  // madvise要求起始地址按页对齐
+  static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+  const uint64_t aligned = offset & ~(kPageSize - 1);
+  static constexpr int kMadvise[] = {MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL,
+                                     MADV_WILLNEED};
+  if (madvise(mmap_base_ + aligned, length + (offset - aligned),
+              kMadvise[pattern]) != 0) {
+    LOG(z_kv::LogLevel::ERROR, "madvise failed, code = [%d]", errno);
+  }
+}
 
 uint64_t FileTool::GetFileSize(const std::string_view& path) {
   if (path.empty()) {
@@ -191,6 +819,14 @@ bool FileTool::Rename(std::string_view from, std::string_view to) {
     return true;
   }
 
+  bool FileTool::Truncate(const std::string& filename, uint64_t size) {
+    if (::truncate(filename.c_str(), static_cast<off_t>(size)) != 0) {
+      LOG(ERROR, "Truncate failed, code = [%d]", errno);
+      return false;
+    }
+    return true;
+  }
+
   bool FileTool::CreateDir(const std::string& dirname)  {
     if (::mkdir(dirname.c_str(), 0755) != 0) {
       LOG(ERROR, "CreateDir failed, code = [%d]", errno);
@@ -207,4 +843,18 @@ bool FileTool::Rename(std::string_view from, std::string_view to) {
     return true;
   }
 
+  bool FileTool::SyncDir(const std::string& dirname) {
+    const int fd = ::open(dirname.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+      LOG(ERROR, "open dir failed, code = [%d]", errno);
+      return false;
+    }
+    const bool success = ::fsync(fd) == 0;
+    if (!success) {
+      LOG(ERROR, "SyncDir failed, code = [%d]", errno);
+    }
+    ::close(fd);
+    return success;
+  }
+
 }  // namespace corekv
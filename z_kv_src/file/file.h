@@ -1,47 +1,202 @@
 #pragma once
 #include <stdint.h>
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include "../db/status.h"
+#include "../utils/mutex.h"
 namespace z_kv {
+// O_DIRECT要求读写的地址、偏移和长度都按逻辑块对齐，统一按4KB对齐
+static constexpr uint32_t kDirectIoAlignment = 4096;
+
+// FileWriter的打开属性
+struct FileWriterOptions {
+  bool append = false;
+  // 使用O_DIRECT绕过页缓存(追加模式不支持)，文件系统不支持时退化为普通写
+  bool direct_io = false;
+  // 缓冲区个数，大于1时写满的缓冲区交给后台io线程写出，调用者继续填充下一个
+  uint32_t buffer_num = 1;
+  // 每写出多少字节调用一次sync_file_range开始回写，最后的Sync不需要一次
+  // 刷出大量脏页，0表示不使用
+  uint64_t bytes_per_sync = 0;
+  // 写到预分配的末尾时再按这个大小fallocate一段(不改变文件大小)，
+  // 减少分配extent的次数，Close时释放没有用到的部分，0表示不预分配
+  uint64_t preallocate_size = 0;
+  // 复用已经存在的文件(追加模式不支持)：不截断，从头覆盖原来的数据，
+  // 写入不需要分配空间，Close时截断到实际写入的大小
+  bool recycle = false;
+};
 
 //写文件句柄，实现了批量写
 class FileWriter final {
  public:
-  FileWriter(const std::string& file_name, bool append = false);
+  FileWriter(const std::string& file_name, bool append = false,
+             bool direct_io = false);
+  FileWriter(const std::string& file_name, const FileWriterOptions& options);
+  FileWriter(const FileWriter&) = delete;
+  FileWriter& operator=(const FileWriter&) = delete;
+  // 异步模式下等待后台的写入完成
   ~FileWriter();
 
   DBStatus Append(const char* data, int32_t len);
 
+  // direct io模式下只写出对齐的部分，不足一个对齐块的数据留在缓冲区
   DBStatus FlushBuffer();
-  void Sync();
+  // 写出缓冲区并fdatasync，任何一步失败都返回错误
+  DBStatus Sync();
   void Close();
+  bool IsDirectIo() const { return direct_io_; }
+  bool IsAsync() const { return io_thread_.joinable(); }
  private:
   ssize_t Writen(const char* data, int len);
+  // direct io模式下写出缓冲区中的数据，pad为true时把不足对齐块的尾部补0写出
+  DBStatus FlushAligned(bool pad);
+  // 写入返回EINVAL时关闭O_DIRECT
+  void DisableDirectIo();
+  // 攒够bytes_per_sync_之后让内核开始回写已经写出的数据
+  void MaybeRangeSync();
+  // 写到end之前保证[0, end)已经预分配
+  void MaybePreallocate(uint64_t end);
+  // 异步模式：把写满的缓冲区交给io线程，换一个空闲的缓冲区继续填充
+  DBStatus SubmitBuffer();
+  // 等待已经提交的缓冲区全部写出，返回后台写入的错误
+  DBStatus WaitForIo();
+  void StopIoThread();
+  void IoLoop();
 
  private:
   //写入缓冲区的大小
   static constexpr uint32_t kMaxFileBufferSize = 65536;
-  //写入缓冲区
-  char buffer_[kMaxFileBufferSize];
+  // 当前填充的缓冲区，同步模式下总是inline_buffer_
+  char* buffer_ = inline_buffer_;
+  //写入缓冲区，direct io直接从这里写出，需要对齐
+  alignas(kDirectIoAlignment) char inline_buffer_[kMaxFileBufferSize];
   //缓冲区中写入的字节数
   int32_t current_pos_ = 0;
   //文件描述符
   int fd_ = -1;
   //文件名
   std::string file_name_;
+  bool direct_io_ = false;
+  // direct io模式下buffer_[0]在文件中的偏移(总是对齐的)
+  uint64_t file_offset_ = 0;
+  // 非direct io模式下已经写出的位置和已经开始回写的位置
+  uint64_t bytes_per_sync_ = 0;
+  uint64_t write_offset_ = 0;
+  uint64_t synced_offset_ = 0;
+  uint64_t preallocate_size_ = 0;
+  // 已经分配了空间的末尾(包括复用的文件原有的大小)
+  uint64_t preallocated_end_ = 0;
+  bool recycle_ = false;
+  // 异步写：等待写出的缓冲区(direct io时带上写入的偏移)和空闲的缓冲区
+  struct IoTask {
+    char* buf;
+    uint32_t size;
+    uint64_t offset;
+  };
+  std::vector<std::unique_ptr<char, void (*)(void*)>> extra_buffers_;
+  std::deque<IoTask> io_tasks_;
+  std::vector<char*> free_buffers_;
+  bool io_running_ = false;
+  bool stop_io_ = false;
+  DBStatus io_status_ = Status::kSuccess;
+  MutexLock io_mutex_;
+  CondVar io_cv_{&io_mutex_};
+  CondVar done_cv_{&io_mutex_};
+  std::thread io_thread_;
+};
+
+class FileReader;
+// 批量读取中的一个请求，result需要预先分配len字节，完成后status为读取结果
+struct ReadRequest {
+  const FileReader* reader = nullptr;
+  uint64_t offset = 0;
+  size_t len = 0;
+  std::string* result = nullptr;
+  DBStatus status;
 };
 
 class FileReader final {
  public:
+  // 访问模式，mmap模式下通过madvise告诉内核如何预读
+  enum AccessPattern {
+    kNormal = 0,
+    // 点查：关闭预读，只读取缺页的那一页
+    kRandom = 1,
+    // 顺序扫描：积极预读，读过的页可以尽快回收
+    kSequential = 2,
+    // 即将访问，提前读入
+    kWillNeed = 3
+  };
   ~FileReader();
-  FileReader(const std::string& file_name);
+  // use_mmap为true时把整个文件只读映射到内存，映射失败时退化为pread
+  // direct_io为true时使用O_DIRECT读取(读入对齐的缓冲区再拷贝)，
+  // 文件系统不支持时退化为普通读，和use_mmap同时设置时使用mmap
+  FileReader(const std::string& file_name, bool use_mmap = false,
+             bool direct_io = false);
+  FileReader(const FileReader&) = delete;
+  FileReader& operator=(const FileReader&) = delete;
   DBStatus Read(uint64_t offset, size_t n, std::string* result) const;
+  // 零拷贝读取：mmap模式下result直接指向映射中的数据(和reader的生命周期一致)，
+  // 否则读入scratch，result指向scratch
+  DBStatus Read(uint64_t offset, size_t n, std::string_view* result,
+                std::string* scratch) const;
+  // 一次提交多个读请求(可以属于不同的文件)并等待全部完成：支持io_uring时
+  // 所有请求一起提交给内核，否则交给后台线程池并行pread。
+  // 返回第一个失败的状态，每个请求的结果在各自的status中
+  static DBStatus MultiRead(ReadRequest* requests, size_t n);
+  // 是否使用io_uring(可用时默认开启)，用于测试和基准对比
+  static void EnableIoUring(bool enable);
+  bool IsMmap() const { return mmap_base_ != nullptr; }
+  bool IsDirectIo() const {
+    return direct_io_.load(std::memory_order_relaxed);
+  }
+  // 对[offset, offset+length)设置访问模式，length为0表示到文件末尾
+  void Advise(AccessPattern pattern, uint64_t offset = 0,
+              uint64_t length = 0) const;
+  // 自动预读：检测到连续的顺序读取时，通过WILLNEED提前读入后面的数据，
+  // 预读大小从kInitReadaheadSize开始每次翻倍直到max_size，随机读时重置。
+  // 多个线程共享reader时预读状态的竞争只会影响提示的准确性
+  void EnableAutoReadahead(size_t max_size);
+  // 固定大小的预读缓冲区：每次读取size字节，后续落在缓冲区内的读取不需要系统调用，
+  // 适合compaction这类单线程顺序读取的输入文件(direct io下同样有效)，
+  // 设置之后reader不能再被多个线程同时使用
+  void SetReadaheadBuffer(size_t size);
+
+ private:
+  // O_DIRECT读取：把[offset, offset+n)扩展到对齐的范围
+  DBStatus DirectRead(uint64_t offset, size_t n, char* result) const;
+  DBStatus ReadFromBuffer(uint64_t offset, size_t n, char* result) const;
+  void MaybeReadahead(uint64_t offset, size_t n) const;
+
+ private:
+  static constexpr uint64_t kInitReadaheadSize = 8 * 1024;
 
  private:
   int fd_=-1;
+  // 读取返回EINVAL时会关闭O_DIRECT
+  mutable std::atomic<bool> direct_io_{false};
+  // mmap模式下映射的起始地址和长度
+  char* mmap_base_ = nullptr;
+  uint64_t mmap_size_ = 0;
+  // 自动预读：上一次读取的结束位置、已经预读到的位置和当前的预读大小
+  size_t max_readahead_size_ = 0;
+  mutable std::atomic<uint64_t> last_read_end_{0};
+  mutable std::atomic<uint64_t> readahead_end_{0};
+  mutable std::atomic<uint64_t> readahead_size_{0};
+  // 固定预读缓冲区(按direct io的要求对齐)，以及其中数据在文件中的范围
+  std::unique_ptr<char, void (*)(void*)> readahead_buffer_{nullptr, &free};
+  size_t readahead_buffer_size_ = 0;
+  mutable uint64_t buffer_offset_ = 0;
+  mutable size_t buffer_len_ = 0;
 };
 
 class FileTool final {
@@ -50,7 +205,10 @@ class FileTool final {
   static bool Exist(std::string_view path );
   static bool Rename(std::string_view from, std::string_view to);
   static bool RemoveFile(const std::string& file_name);
+  static bool Truncate(const std::string& file_name, uint64_t size);
   static bool RemoveDir(const std::string& dirname);
   static bool CreateDir(const std::string& dirname);
+  // rename/创建文件之后需要fsync所在目录，目录项才能保证落盘
+  static bool SyncDir(const std::string& dirname);
 };
 }  // namespace corekv
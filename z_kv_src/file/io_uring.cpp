@@ -0,0 +1,210 @@
+#include "io_uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include "../logger/log.h"
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define Z_KV_HAVE_IO_URING 1
+#endif
+#endif
+namespace z_kv {
+#ifdef Z_KV_HAVE_IO_URING
+namespace {
+// 每个线程的队列深度，一次MultiGet涉及的block数一般不会超过它
+constexpr uint32_t kQueueDepth = 64;
+int IoUringSetup(uint32_t entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+int IoUringEnter(int fd, uint32_t to_submit, uint32_t min_complete,
+                 uint32_t flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+inline uint32_t LoadAcquire(const uint32_t* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+inline void StoreRelease(uint32_t* p, uint32_t value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+}  // namespace
+
+IoUring* IoUring::ThreadLocal() {
+  // 初始化失败(例如内核不支持或被seccomp禁止)时保存nullptr，不再重试
+  thread_local std::unique_ptr<IoUring> ring = []() {
+    std::unique_ptr<IoUring> instance(new IoUring());
+    if (!instance->Init(kQueueDepth)) {
+      instance.reset();
+    }
+    return instance;
+  }();
+  return ring.get();
+}
+bool IoUring::Init(uint32_t entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IoUringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    ring_fd_ = -1;
+    return false;
+  }
+  entries_ = params.sq_entries;
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ =
+        sq_ring_size_ > cq_ring_size_ ? sq_ring_size_ : cq_ring_size_;
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    return false;
+  }
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      return false;
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED) {
+    sqes_ = nullptr;
+    return false;
+  }
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+  return true;
+}
+IoUring::~IoUring() {
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+}
+uint32_t IoUring::Reap(ReadOp* ops, size_t n) {
+  const io_uring_cqe* cqes = static_cast<const io_uring_cqe*>(cqes_);
+  uint32_t reaped = 0;
+  uint32_t head = *cq_head_;
+  while (head != LoadAcquire(cq_tail_)) {
+    const io_uring_cqe& cqe = cqes[head & cq_mask_];
+    if (cqe.user_data < n) {
+      ops[cqe.user_data].res = cqe.res;
+    }
+    ++head;
+    ++reaped;
+  }
+  StoreRelease(cq_head_, head);
+  return reaped;
+}
+void IoUring::Drain(ReadOp* ops, size_t n, uint32_t in_flight) {
+  while (true) {
+    const uint32_t reaped = Reap(ops, n);
+    in_flight -= reaped < in_flight ? reaped : in_flight;
+    if (in_flight == 0) {
+      return;
+    }
+    // 等待失败也不能放弃，调用者返回之后内核可能还在写缓冲区；
+    // 完成事件在任意一次陷入内核时都会投递，稍后再检查
+    if (IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      usleep(100);
+    }
+  }
+}
+bool IoUring::ReadAll(ReadOp* ops, size_t n) {
+  if (broken_) {
+    return false;
+  }
+  // 使用READV(5.1内核就支持)
+  iovecs_.resize(entries_);
+  io_uring_sqe* sqes = static_cast<io_uring_sqe*>(sqes_);
+  for (size_t begin = 0; begin < n; begin += entries_) {
+    const uint32_t batch =
+        static_cast<uint32_t>(n - begin < entries_ ? n - begin : entries_);
+    const uint32_t start = *sq_tail_;
+    uint32_t tail = start;
+    for (uint32_t i = 0; i < batch; ++i) {
+      ReadOp& op = ops[begin + i];
+      iovecs_[i].iov_base = op.buf;
+      iovecs_[i].iov_len = op.len;
+      const uint32_t index = tail & sq_mask_;
+      io_uring_sqe* sqe = &sqes[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_READV;
+      sqe->fd = op.fd;
+      sqe->addr = reinterpret_cast<uint64_t>(&iovecs_[i]);
+      sqe->len = 1;
+      sqe->off = op.offset;
+      sqe->user_data = begin + i;
+      sq_array_[index] = index;
+      ++tail;
+    }
+    // 内核看到tail之前sqe必须已经写完
+    StoreRelease(sq_tail_, tail);
+    uint32_t completed = 0;
+    while (true) {
+      // EBUSY表示完成队列已满，每次进入内核之前先收割
+      completed += Reap(ops, n);
+      if (completed >= batch) {
+        break;
+      }
+      // 内核每取走一个sqe就推进head
+      const uint32_t to_submit = tail - LoadAcquire(sq_head_);
+      const int ret = IoUringEnter(ring_fd_, to_submit, 1,
+                                   IORING_ENTER_GETEVENTS);
+      if (ret >= 0 || errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        continue;
+      }
+      LOG(z_kv::LogLevel::ERROR, "io_uring_enter failed, code = [%d]", errno);
+      // 撤回内核还没有取走的sqe，已经提交的必须等它们完成，
+      // 否则调用者退化为同步读时内核还可能往同一块缓冲区中写
+      const uint32_t head = LoadAcquire(sq_head_);
+      StoreRelease(sq_tail_, head);
+      Drain(ops, n, head - start - completed);
+      broken_ = true;
+      return false;
+    }
+  }
+  return true;
+}
+#else
+IoUring* IoUring::ThreadLocal() { return nullptr; }
+bool IoUring::Init(uint32_t) { return false; }
+IoUring::~IoUring() {}
+bool IoUring::ReadAll(ReadOp*, size_t) { return false; }
+#endif  // Z_KV_HAVE_IO_URING
+}  // namespace corekv
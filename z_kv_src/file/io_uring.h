@@ -0,0 +1,63 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <vector>
+namespace z_kv {
+// 不依赖liburing，直接通过系统调用使用io_uring批量提交读请求
+// 每个线程一个实例(提交和收割都在调用线程完成，不需要加锁)
+class IoUring final {
+ public:
+  struct ReadOp {
+    int fd = -1;
+    uint64_t offset = 0;
+    size_t len = 0;
+    char* buf = nullptr;
+    // 读到的字节数，失败时为-errno
+    ssize_t res = 0;
+  };
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+  ~IoUring();
+  // 当前线程的实例，内核或编译环境不支持io_uring时返回nullptr
+  static IoUring* ThreadLocal();
+  // 提交所有读请求并等待全部完成，超过队列深度时分批提交
+  // 返回false表示io_uring本身出错，调用者需要退化为同步读，返回时已经没有
+  // 仍在进行的请求，之后这个实例不再使用
+  bool ReadAll(ReadOp* ops, size_t n);
+
+ private:
+  IoUring() = default;
+  bool Init(uint32_t entries);
+  // 收割完成队列中的所有事件，返回收割的个数
+  uint32_t Reap(ReadOp* ops, size_t n);
+  // 出错之后等待已经提交的in_flight个请求全部完成
+  void Drain(ReadOp* ops, size_t n, uint32_t in_flight);
+
+ private:
+  int ring_fd_ = -1;
+  uint32_t entries_ = 0;
+  // io_uring_enter出错之后不再使用
+  bool broken_ = false;
+  // READV的iovec需要保持到请求完成
+  std::vector<iovec> iovecs_;
+  // 提交队列
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  uint32_t* sq_head_ = nullptr;
+  uint32_t* sq_tail_ = nullptr;
+  uint32_t sq_mask_ = 0;
+  uint32_t* sq_array_ = nullptr;
+  void* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  // 完成队列
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  uint32_t* cq_head_ = nullptr;
+  uint32_t* cq_tail_ = nullptr;
+  uint32_t cq_mask_ = 0;
+  void* cqes_ = nullptr;
+};
+}  // namespace corekv
@@ -0,0 +1,163 @@
+#include "blocked_bloomfilter.h"
+
+#include <atomic>
+#include <vector>
+
+#include "utils/codec.h"
+#include "utils/hash_util.h"
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define Z_KV_HAVE_AVX2_PROBE 1
+#endif
+namespace z_kv {
+namespace {
+// 每次探测使用不同的奇数乘数，乘积的高9位就是块内的位置(0-511)
+constexpr uint32_t kProbeMultipliers[BlockedBloomFilter::kMaxProbes] = {
+    0x9e3779b1, 0x85ebca77, 0xc2b2ae3d, 0x27d4eb2f,
+    0x165667b1, 0xd3a2646d, 0xfd7046c5, 0xb55a4f09};
+constexpr uint32_t kBlockBitsShift = 32 - 9;
+// 把hash均匀映射到[0, n)，用乘法代替取模
+inline uint32_t FastRange(uint32_t hash, uint32_t n) {
+  return static_cast<uint32_t>((static_cast<uint64_t>(hash) * n) >> 32);
+}
+bool ProbeScalar(const char* block, uint32_t h, uint32_t probes) {
+  for (uint32_t i = 0; i < probes; ++i) {
+    const uint32_t bitpos = (h * kProbeMultipliers[i]) >> kBlockBitsShift;
+    if ((block[bitpos >> 3] & (1 << (bitpos & 7))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+#ifdef Z_KV_HAVE_AVX2_PROBE
+// 8个探测位同时计算：gather读出8个32位字，一次testc判断是否全部置位
+// 小端下第w个字的第b位就是块内的第w*32+b位，和标量版本的布局一致
+__attribute__((target("avx2"))) bool ProbeAvx2(const char* block, uint32_t h,
+                                               uint32_t probes) {
+  const __m256i multipliers = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i*>(kProbeMultipliers));
+  const __m256i bitpos = _mm256_srli_epi32(
+      _mm256_mullo_epi32(_mm256_set1_epi32(h), multipliers), kBlockBitsShift);
+  const __m256i words = _mm256_i32gather_epi32(
+      reinterpret_cast<const int*>(block), _mm256_srli_epi32(bitpos, 5), 4);
+  __m256i bits = _mm256_sllv_epi32(
+      _mm256_set1_epi32(1), _mm256_and_si256(bitpos, _mm256_set1_epi32(31)));
+  // 超过探测次数的lane不参与判断
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  bits = _mm256_and_si256(
+      bits, _mm256_cmpgt_epi32(_mm256_set1_epi32(probes), lanes));
+  return _mm256_testc_si256(words, bits);
+}
+bool CpuSupportsAvx2() { return __builtin_cpu_supports("avx2"); }
+#else
+bool CpuSupportsAvx2() { return false; }
+#endif
+std::atomic<bool> use_simd{CpuSupportsAvx2()};
+}  // namespace
+
+BlockedBloomFilter::BlockedBloomFilter(int32_t bits_per_key)
+    : bits_per_key_(bits_per_key < 1 ? 1 : bits_per_key) {
+  // 分块之后同一个块中的key更集中，探测次数比普通布隆过滤器稍少
+  uint32_t probes = static_cast<uint32_t>(bits_per_key_ * 0.69314718056);
+  probes = probes < 1 ? 1 : probes;
+  probes = probes > kMaxProbes ? kMaxProbes : probes;
+  filter_policy_meta_.hash_num = probes;
+}
+const char* BlockedBloomFilter::Name() { return kName; }
+void BlockedBloomFilter::EnableSimd(bool enable) {
+  use_simd.store(enable && CpuSupportsAvx2(), std::memory_order_relaxed);
+}
+uint32_t BlockedBloomFilter::BlockNum(int32_t n) const {
+  const uint64_t bytes = (static_cast<uint64_t>(n) * bits_per_key_ + 7) / 8;
+  const uint64_t num_blocks = (bytes + kBlockBytes - 1) / kBlockBytes;
+  return num_blocks < 1 ? 1 : static_cast<uint32_t>(num_blocks);
+}
+void BlockedBloomFilter::CreateFilter(const std::string* keys, int32_t n) {
+  if (n <= 0 || !keys) {
+    return;
+  }
+  std::vector<uint64_t> hashes;
+  hashes.reserve(n);
+  for (int32_t i = 0; i < n; ++i) {
+    hashes.push_back(hash_util::Hash64(keys[i].data(), keys[i].size()));
+  }
+  const uint32_t num_blocks = BlockNum(n);
+  const size_t init_size = bloomfilter_data_.size();
+  bloomfilter_data_.resize(init_size + num_blocks * kBlockBytes, 0);
+  AddHashes(hashes.data(), n, &bloomfilter_data_[init_size], num_blocks);
+}
+void BlockedBloomFilter::CreateFilter(const uint64_t* hashes, int32_t n,
+                                      std::string* dst) const {
+  if (n <= 0 || !hashes || !dst) {
+    return;
+  }
+  const uint32_t num_blocks = BlockNum(n);
+  const size_t init_size = dst->size();
+  dst->resize(init_size + num_blocks * kBlockBytes, 0);
+  AddHashes(hashes, n, &(*dst)[init_size], num_blocks);
+  util::PutFixed32(dst, filter_policy_meta_.hash_num |
+                            (hash_util::kHash64Version << 8));
+}
+void BlockedBloomFilter::AddHashes(const uint64_t* hashes, int32_t n,
+                                   char* array, uint32_t num_blocks) const {
+  for (int32_t i = 0; i < n; ++i) {
+    char* block = array + FastRange(hashes[i] >> 32, num_blocks) * kBlockBytes;
+    const uint32_t h = static_cast<uint32_t>(hashes[i]);
+    for (uint32_t j = 0; j < filter_policy_meta_.hash_num; ++j) {
+      const uint32_t bitpos = (h * kProbeMultipliers[j]) >> kBlockBitsShift;
+      block[bitpos >> 3] |= (1 << (bitpos & 7));
+    }
+  }
+}
+bool BlockedBloomFilter::Probe(const char* array, uint32_t num_blocks,
+                               uint32_t probes, uint64_t hash) {
+  const char* block = array + FastRange(hash >> 32, num_blocks) * kBlockBytes;
+  const uint32_t h = static_cast<uint32_t>(hash);
+#ifdef Z_KV_HAVE_AVX2_PROBE
+  if (use_simd.load(std::memory_order_relaxed)) {
+    return ProbeAvx2(block, h, probes);
+  }
+#endif
+  return ProbeScalar(block, h, probes);
+}
+bool BlockedBloomFilter::MayMatch(const std::string_view& key,
+                                  int32_t start_pos, int32_t len) {
+  if (key.empty() || bloomfilter_data_.empty()) {
+    return false;
+  }
+  const size_t total_len = bloomfilter_data_.size();
+  if (start_pos < 0 || static_cast<size_t>(start_pos) >= total_len) {
+    return false;
+  }
+  if (len == 0) {
+    len = total_len - start_pos;
+  }
+  const uint32_t num_blocks = len / kBlockBytes;
+  if (num_blocks == 0) {
+    return true;
+  }
+  return Probe(bloomfilter_data_.data() + start_pos, num_blocks,
+               filter_policy_meta_.hash_num,
+               hash_util::Hash64(key.data(), key.size()));
+}
+bool BlockedBloomFilter::MayMatch(const std::string_view& key,
+                                  const std::string_view& bf_datas) {
+  static constexpr uint32_t kFixedSize = 4;
+  const size_t size = bf_datas.size();
+  if (size < kFixedSize || key.empty()) {
+    return false;
+  }
+  const uint32_t meta =
+      util::DecodeFixed32(bf_datas.data() + size - kFixedSize);
+  const uint32_t probes = meta & 0xff;
+  const uint32_t hash_version = meta >> 8;
+  const uint32_t num_blocks = (size - kFixedSize) / kBlockBytes;
+  // 未知的格式不能过滤
+  if (probes > kMaxProbes || num_blocks == 0 ||
+      hash_version > hash_util::kHash64Version) {
+    return true;
+  }
+  return Probe(bf_datas.data(), num_blocks, probes,
+               FilterKeyHash(hash_version, key));
+}
+}  // namespace corekv
@@ -0,0 +1,45 @@
+#pragma once
+#include "filter_policy.h"
+namespace z_kv {
+// 按cache line分块的布隆过滤器：一个key的所有探测位都落在同一个64字节的块中，
+// 块由64位hash的高32位选择，块内的探测位由低32位生成，
+// 一次否定查询最多一次cache miss。块内的位置用乘法+移位生成，不需要取模，
+// 支持AVX2时8个探测位一次完成
+// 格式：|num_blocks * 64字节|探测次数 | hash版本<<8(fixed32)|
+class BlockedBloomFilter final : public FilterPolicy {
+ public:
+  static constexpr uint32_t kBlockBytes = 64;
+  // 一个块内最多探测的次数(AVX2一次处理8个)
+  static constexpr uint32_t kMaxProbes = 8;
+  static constexpr char kName[] = "blocked_bloomfilter";
+
+  BlockedBloomFilter(int32_t bits_per_key);
+  ~BlockedBloomFilter() = default;
+  const char* Name() override;
+  const std::string& Data() override { return bloomfilter_data_; }
+  const FilterPolicyMeta& GetMeta() override { return filter_policy_meta_; }
+  void CreateFilter(const std::string* keys, int32_t n) override;
+  void CreateFilter(const uint64_t* hashes, int32_t n,
+                    std::string* dst) const override;
+  bool MayMatch(const std::string_view& key, int32_t start_pos,
+                int32_t len) override;
+  uint32_t Size() override { return bloomfilter_data_.size(); }
+  bool MayMatch(const std::string_view& key,
+                const std::string_view& bf_datas) override;
+  // 是否使用AVX2探测(CPU支持时默认开启)，用于测试和基准对比
+  static void EnableSimd(bool enable);
+
+ private:
+  // n个key需要的块数
+  uint32_t BlockNum(int32_t n) const;
+  void AddHashes(const uint64_t* hashes, int32_t n, char* array,
+                 uint32_t num_blocks) const;
+  static bool Probe(const char* array, uint32_t num_blocks, uint32_t probes,
+                    uint64_t hash);
+
+ private:
+  FilterPolicyMeta filter_policy_meta_;
+  int32_t bits_per_key_ = 0;
+  std::string bloomfilter_data_;
+};
+}  // namespace corekv
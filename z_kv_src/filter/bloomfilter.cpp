@@ -9,6 +9,20 @@
 //哈希函数个数k
 //要求哈希碰撞概率p
 namespace z_kv {
+namespace {
+// 双重hash的起点和步长：版本0只使用SimMurMurHash(64位hash的高32位)，
+// 新版本直接使用Hash64的低32位和高32位，两部分相互独立
+inline void ProbeStart(uint64_t hash, uint32_t hash_version,
+                       uint32_t* hash_val, uint32_t* delta) {
+  if (hash_version == 0) {
+    *hash_val = static_cast<uint32_t>(hash >> 32);
+    *delta = (*hash_val >> 17) | (*hash_val << 15);  // Rotate right 17 bits
+  } else {
+    *hash_val = static_cast<uint32_t>(hash);
+    *delta = static_cast<uint32_t>(hash >> 32);
+  }
+}
+}  // namespace
 //构造过程确定了最优k值
 //构造（1）：bits_per_key --> m/n的值
 BloomFilter::BloomFilter(int32_t bits_per_key) : bits_per_key_(bits_per_key) {
@@ -37,7 +51,7 @@ void BloomFilter::CalcBloomBitsPerKey(int32_t entries_num, float positive) {
   bits_per_key_ = static_cast<int32_t>(ceilf(size / entries_num));
 }
 //返回布隆过滤器名称
-const char* BloomFilter::Name() { return "general_bloomfilter"; }
+const char* BloomFilter::Name() { return kName; }
 //为n条数据创建布隆过滤器，
 void BloomFilter::CreateFilter(const std::string* keys, int32_t n) {
   if (n <= 0 || !keys) {
@@ -54,17 +68,41 @@ void BloomFilter::CreateFilter(const std::string* keys, int32_t n) {
   bloomfilter_data_.resize(init_size + bytes, 0);
   // 转成数组使用起来更方便
   char* array = &(bloomfilter_data_)[init_size];
-
+  std::vector<uint64_t> hashes;
+  hashes.reserve(n);
+  for (int32_t i = 0; i < n; ++i) {
+    hashes.push_back(static_cast<uint64_t>(hash_util::SimMurMurHash(
+                         keys[i].data(), keys[i].size()))
+                     << 32);
+  }
+  AddHashes(hashes.data(), n, array, bits, 0);
+}
+//创建独立的过滤器：|bits|hash个数 | hash版本<<8(fixed32)|，和sst中保存的格式一致
+//旧版本的读取方会认为hash个数大于30，不做过滤
+void BloomFilter::CreateFilter(const uint64_t* hashes, int32_t n,
+                               std::string* dst) const {
+  if (n <= 0 || !hashes || !dst) {
+    return;
+  }
+  int32_t bits = n * bits_per_key_;
+  bits = bits < 64 ? 64 : bits;
+  const int32_t bytes = (bits + 7) / 8;
+  bits = bytes * 8;
+  const size_t init_size = dst->size();
+  dst->resize(init_size + bytes, 0);
+  AddHashes(hashes, n, &(*dst)[init_size], bits, hash_util::kHash64Version);
+  util::PutFixed32(dst, filter_policy_meta_.hash_num |
+                            (hash_util::kHash64Version << 8));
+}
+void BloomFilter::AddHashes(const uint64_t* hashes, int32_t n, char* array,
+                            int32_t bits, uint32_t hash_version) const {
   //在布隆过滤器上写一
   for (int i = 0; i < n; i++) {
     // Use double-hashing to generate a sequence of hash values.
     // See analysis in [Kirsch,Mitzenmacher 2006].
-    //根据key计算一次hash值
-    uint32_t hash_val =
-        hash_util::SimMurMurHash(keys[i].data(), keys[i].size());
-    //计算一个基数，将hash值累加k-1次这个数，进而模拟k个哈希函数产生的hash值
-    const uint32_t delta =
-        (hash_val >> 17) | (hash_val << 15);  // Rotate right 17 bits
+    //计算起点和一个基数，将hash值累加k-1次这个数，进而模拟k个哈希函数产生的hash值
+    uint32_t hash_val, delta;
+    ProbeStart(hashes[i], hash_version, &hash_val, &delta);
     for (size_t j = 0; j < filter_policy_meta_.hash_num; j++) {
       const uint32_t bitpos = hash_val % bits;
       //位操作赋1
@@ -119,17 +157,20 @@ bool BloomFilter::MayMatch(const std::string_view& key,
   if (size < kFixedSize || key.empty()) {
     return false;
   }
-  uint32_t k = util::DecodeFixed32(bf_datas.data() + size - kFixedSize);
-  if (k > 30) {
+  const uint32_t meta =
+      util::DecodeFixed32(bf_datas.data() + size - kFixedSize);
+  const uint32_t k = meta & 0xff;
+  const uint32_t hash_version = meta >> 8;
+  if (k > 30 || hash_version > hash_util::kHash64Version) {
     return true;
   }
-  
+
   const int32_t bits = (size - kFixedSize) * 8;
   std::string_view bloom_filter(bf_datas.data(), size - kFixedSize);
   const char* cur_array = bloom_filter.data();
-  uint32_t hash_val = hash_util::SimMurMurHash(key.data(), key.size());
-  const uint32_t delta =
-      (hash_val >> 17) | (hash_val << 15);  // Rotate right 17 bits
+  uint32_t hash_val, delta;
+  ProbeStart(FilterKeyHash(hash_version, key), hash_version, &hash_val,
+             &delta);
   for (int32_t j = 0; j < k; j++) {
     const uint32_t bitpos = hash_val % bits;
     if ((cur_array[bitpos / 8] & (1 << (bitpos % 8))) == 0) {
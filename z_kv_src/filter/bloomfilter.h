@@ -1,8 +1,11 @@
 #pragma once
+#include <vector>
+
 #include "filter_policy.h"
 namespace z_kv {
 class BloomFilter final : public FilterPolicy {
  public:
+  static constexpr char kName[] = "general_bloomfilter";
   //直接给定每个key占的位数
   BloomFilter(int32_t bits_per_key);
   //通过误差率反算出每个key所占的位数
@@ -14,6 +17,8 @@ class BloomFilter final : public FilterPolicy {
     return filter_policy_meta_;
   }
   void CreateFilter(const std::string* keys, int32_t n) override;
+  void CreateFilter(const uint64_t* hashes, int32_t n,
+                    std::string* dst) const override;
   bool MayMatch(const std::string_view& key, int32_t start_pos,
                 int32_t len) override;
   uint32_t Size() override { return bloomfilter_data_.size(); }
@@ -23,6 +28,9 @@ class BloomFilter final : public FilterPolicy {
  private:
   void CalcBloomBitsPerKey(int32_t entries_num, float positive = 0.01);
   void CalcHashNum();
+  // 在array(bits位)上写入n个key的hash，hash_version为0时只使用高32位
+  void AddHashes(const uint64_t* hashes, int32_t n, char* array, int32_t bits,
+                 uint32_t hash_version) const;
 
  private:
   FilterPolicyMeta filter_policy_meta_;
@@ -1,12 +1,24 @@
 #pragma once
+#include <stdint.h>
+
 #include <string>
 #include <string_view>
+
+#include "../utils/hash_util.h"
 // 用于过滤
 namespace z_kv {
 //保存hash函数个数
 struct FilterPolicyMeta {
   uint32_t hash_num;
 };
+// 过滤器中记录了构建时使用的hash版本(hash_util::kHash64Version)，
+// 查询时用相同版本的hash计算key，0是旧版本的SimMurMurHash64
+inline uint64_t FilterKeyHash(uint32_t hash_version,
+                              const std::string_view& key) {
+  return hash_version == 0
+             ? hash_util::SimMurMurHash64(key.data(), key.size())
+             : hash_util::Hash64(key.data(), key.size());
+}
 class FilterPolicy {
  public:
   FilterPolicy() = default;
@@ -14,6 +26,11 @@ class FilterPolicy {
   // 当前过滤器的名字
   virtual const char* Name() = 0;
   virtual void CreateFilter(const std::string* keys, int n) = 0;
+  // 用n个key的64位hash(hash_util::Hash64)创建一个独立的过滤器追加到dst中
+  // (包含查询需要的参数)，构建时不需要保存key本身；不修改对象自身的状态，
+  // 多个sst或者多个分区可以共用同一个policy对象
+  virtual void CreateFilter(const uint64_t* hashes, int32_t n,
+                            std::string* dst) const = 0;
   virtual bool MayMatch(const std::string_view& key, int32_t start_pos,
                         int32_t len) = 0;
   virtual bool MayMatch(const std::string_view& key,
@@ -0,0 +1,178 @@
+#include "xor_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "utils/codec.h"
+#include "utils/hash_util.h"
+namespace z_kv {
+namespace {
+constexpr uint32_t kTrailerSize = sizeof(uint64_t) + sizeof(uint32_t);
+constexpr uint64_t kInitSeed = 0x726b2b9d438b9d4dULL;
+// 构建失败的概率很低，多次失败时放弃过滤(MayMatch总是返回true)
+constexpr int32_t kMaxBuildAttempts = 64;
+// 分段长度字段的高8位保存hash版本
+constexpr uint32_t kBlockLengthMask = (1u << 24) - 1;
+inline uint64_t Fmix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+inline uint64_t Mix(uint64_t hash, uint64_t seed) { return Fmix64(hash + seed); }
+inline uint64_t Rotl64(uint64_t n, uint32_t c) {
+  return (n << (c & 63)) | (n >> ((-c) & 63));
+}
+// 第index个分段中的槽位，用乘法代替取模
+inline uint32_t Slot(uint64_t h, uint32_t index, uint32_t block_length) {
+  const uint32_t r = static_cast<uint32_t>(Rotl64(h, index * 21));
+  return static_cast<uint32_t>((static_cast<uint64_t>(r) * block_length) >>
+                               32) +
+         index * block_length;
+}
+inline uint8_t Fingerprint(uint64_t h) {
+  return static_cast<uint8_t>(h ^ (h >> 32));
+}
+}  // namespace
+
+XorFilter::XorFilter() { filter_policy_meta_.hash_num = 3; }
+const char* XorFilter::Name() { return kName; }
+void XorFilter::Build(std::vector<uint64_t>& hashes, std::string* dst) {
+  // 相同的hash无法放进三个槽位的方程组中，先去重
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+  const uint32_t size = hashes.size();
+  uint32_t capacity = 32 + static_cast<uint32_t>(std::ceil(1.23 * size));
+  capacity = capacity / 3 * 3;
+  uint32_t block_length = capacity / 3;
+
+  std::vector<uint64_t> xor_masks(capacity);
+  std::vector<uint32_t> counts(capacity);
+  std::vector<uint32_t> queue;
+  queue.reserve(capacity);
+  // 剥离顺序：(混合后的hash，它独占的槽位)
+  std::vector<std::pair<uint64_t, uint32_t>> stack;
+  stack.reserve(size);
+  uint64_t seed = kInitSeed;
+  bool built = false;
+  for (int32_t attempt = 0; attempt < kMaxBuildAttempts; ++attempt) {
+    std::fill(xor_masks.begin(), xor_masks.end(), 0);
+    std::fill(counts.begin(), counts.end(), 0);
+    queue.clear();
+    stack.clear();
+    for (const uint64_t hash : hashes) {
+      const uint64_t h = Mix(hash, seed);
+      for (uint32_t i = 0; i < 3; ++i) {
+        const uint32_t slot = Slot(h, i, block_length);
+        xor_masks[slot] ^= h;
+        ++counts[slot];
+      }
+    }
+    for (uint32_t slot = 0; slot < capacity; ++slot) {
+      if (counts[slot] == 1) {
+        queue.push_back(slot);
+      }
+    }
+    // 不断剥离只被一个key使用的槽位
+    while (!queue.empty()) {
+      const uint32_t slot = queue.back();
+      queue.pop_back();
+      if (counts[slot] != 1) {
+        continue;
+      }
+      const uint64_t h = xor_masks[slot];
+      stack.emplace_back(h, slot);
+      for (uint32_t i = 0; i < 3; ++i) {
+        const uint32_t other = Slot(h, i, block_length);
+        xor_masks[other] ^= h;
+        if (--counts[other] == 1) {
+          queue.push_back(other);
+        }
+      }
+    }
+    if (stack.size() == size) {
+      built = true;
+      break;
+    }
+    seed = Fmix64(seed + 0x9e3779b97f4a7c15ULL);
+  }
+  if (!built || block_length > kBlockLengthMask) {
+    capacity = 0;
+    block_length = 0;
+    stack.clear();
+  }
+  // 按剥离的逆序赋值，保证每个key三个槽位的异或等于它的指纹
+  const size_t init_size = dst->size();
+  dst->resize(init_size + capacity, 0);
+  uint8_t* fingerprints = reinterpret_cast<uint8_t*>(&(*dst)[init_size]);
+  for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+    const uint64_t h = it->first;
+    uint8_t fingerprint = Fingerprint(h);
+    for (uint32_t i = 0; i < 3; ++i) {
+      fingerprint ^= fingerprints[Slot(h, i, block_length)];
+    }
+    fingerprints[it->second] = fingerprint;
+  }
+  util::PutFixed64(dst, seed);
+  util::PutFixed32(dst, block_length | (hash_util::kHash64Version << 24));
+}
+void XorFilter::CreateFilter(const std::string* keys, int32_t n) {
+  if (n <= 0 || !keys) {
+    return;
+  }
+  std::vector<uint64_t> hashes;
+  hashes.reserve(n);
+  for (int32_t i = 0; i < n; ++i) {
+    hashes.push_back(hash_util::Hash64(keys[i].data(), keys[i].size()));
+  }
+  Build(hashes, &filter_data_);
+}
+void XorFilter::CreateFilter(const uint64_t* hashes, int32_t n,
+                             std::string* dst) const {
+  if (n <= 0 || !hashes || !dst) {
+    return;
+  }
+  std::vector<uint64_t> sorted_hashes(hashes, hashes + n);
+  Build(sorted_hashes, dst);
+}
+//查询是否存在（多个过滤器连续存放时使用start_pos和len指定使用哪一个）
+bool XorFilter::MayMatch(const std::string_view& key, int32_t start_pos,
+                         int32_t len) {
+  if (key.empty() || filter_data_.empty()) {
+    return false;
+  }
+  const size_t total_len = filter_data_.size();
+  if (start_pos < 0 || static_cast<size_t>(start_pos) >= total_len) {
+    return false;
+  }
+  if (len == 0) {
+    len = total_len - start_pos;
+  }
+  return MayMatch(key, std::string_view(filter_data_.data() + start_pos, len));
+}
+bool XorFilter::MayMatch(const std::string_view& key,
+                         const std::string_view& bf_datas) {
+  const size_t size = bf_datas.size();
+  if (size < kTrailerSize || key.empty()) {
+    return false;
+  }
+  const char* trailer = bf_datas.data() + size - kTrailerSize;
+  const uint64_t seed = util::DecodeFixed64(trailer);
+  const uint32_t packed = util::DecodeFixed32(trailer + sizeof(uint64_t));
+  const uint32_t block_length = packed & kBlockLengthMask;
+  const uint32_t hash_version = packed >> 24;
+  // 构建失败或者格式不对时不能过滤
+  if (block_length == 0 || hash_version > hash_util::kHash64Version ||
+      static_cast<uint64_t>(block_length) * 3 != size - kTrailerSize) {
+    return true;
+  }
+  const uint8_t* fingerprints =
+      reinterpret_cast<const uint8_t*>(bf_datas.data());
+  const uint64_t h = Mix(FilterKeyHash(hash_version, key), seed);
+  return Fingerprint(h) == (fingerprints[Slot(h, 0, block_length)] ^
+                            fingerprints[Slot(h, 1, block_length)] ^
+                            fingerprints[Slot(h, 2, block_length)]);
+}
+}  // namespace corekv
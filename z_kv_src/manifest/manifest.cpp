@@ -1,117 +1,533 @@
 #include "manifest.h"
 
+#include <algorithm>
+
 #include "../file/file.h"
 #include "../file/file_name.h"
 #include "../logger/log.h"
+#include "../utils/codec.h"
+#include "../utils/crc32.h"
 #include "manifest_change_edit.h"
 #include "manifest_options.h"
 namespace z_kv {
 
-ManifestHandler::ManifestHandler(const std::string& db_path)
-    : db_path_(db_path) {}
-// db_path：参数是db路径，该参数应该是db::Open参数设置的
-bool ManifestHandler::OpenManifestFile() {
-  const auto& manifest_name =
-      FileName::DescriptorFileName(db_path_, ManifestOptions::kManifestName);
-  if (!FileTool::Exist(manifest_name)) {
-    CreateNewManifestFile();
-    const auto& res = RecoverFromReWriteManifestFile();
-    if (!res) {
-      return res;
+void Manifest::SortLevel(uint32_t level) {
+  if (level >= level_tables_map.size()) {
+    return;
+  }
+  if (level_sorted_tables.size() < level_tables_map.size()) {
+    level_sorted_tables.resize(level_tables_map.size());
+  }
+  auto& sorted_tables = level_sorted_tables[level];
+  sorted_tables.assign(level_tables_map[level].begin(),
+                       level_tables_map[level].end());
+  std::sort(sorted_tables.begin(), sorted_tables.end(),
+            [this](uint64_t a, uint64_t b) {
+              const auto& meta_a = table_levels_map.at(a);
+              const auto& meta_b = table_levels_map.at(b);
+              if (meta_a.smallest_key != meta_b.smallest_key) {
+                return meta_a.smallest_key < meta_b.smallest_key;
+              }
+              return a < b;
+            });
+}
+
+bool Manifest::FindTable(uint32_t level, const std::string_view& key,
+                         uint64_t* sst_id) const {
+  // L0层的sst之间key范围可能重叠，不能二分
+  if (level == 0 || level >= level_sorted_tables.size() || !sst_id) {
+    return false;
+  }
+  const auto& sorted_tables = level_sorted_tables[level];
+  // 找到第一个largest_key >= key的sst
+  const auto& iter = std::lower_bound(
+      sorted_tables.begin(), sorted_tables.end(), key,
+      [this](uint64_t id, const std::string_view& target) {
+        return std::string_view(table_levels_map.at(id).largest_key) < target;
+      });
+  if (iter == sorted_tables.end()) {
+    return false;
+  }
+  if (key < std::string_view(table_levels_map.at(*iter).smallest_key)) {
+    return false;
+  }
+  *sst_id = *iter;
+  return true;
+}
+
+// smallest或者largest为空时表示对应的一端没有边界
+void Manifest::GetOverlappingTables(uint32_t level,
+                                    const std::string_view& smallest,
+                                    const std::string_view& largest,
+                                    std::vector<uint64_t>* sst_ids) const {
+  if (level >= level_sorted_tables.size() || !sst_ids) {
+    return;
+  }
+  const auto& sorted_tables = level_sorted_tables[level];
+  auto begin = sorted_tables.begin();
+  // L1及以上层可以直接跳过largest_key < smallest的sst
+  if (level > 0 && !smallest.empty()) {
+    begin = std::lower_bound(
+        sorted_tables.begin(), sorted_tables.end(), smallest,
+        [this](uint64_t id, const std::string_view& target) {
+          return std::string_view(table_levels_map.at(id).largest_key) <
+                 target;
+        });
+  }
+  for (auto iter = begin; iter != sorted_tables.end(); ++iter) {
+    const auto& table_meta = table_levels_map.at(*iter);
+    // 按smallest_key排序，后面的sst也不会和[smallest, largest]重叠了
+    if (!largest.empty() &&
+        std::string_view(table_meta.smallest_key) > largest) {
+      break;
+    }
+    if (!smallest.empty() &&
+        std::string_view(table_meta.largest_key) < smallest) {
+      continue;
     }
+    sst_ids->emplace_back(*iter);
   }
-  return ReplayManifestFile();
 }
-// 重放manifest文件
-bool ManifestHandler::ReplayManifestFile() {
-  const auto& manifest_name =
-      FileName::DescriptorFileName(db_path_, ManifestOptions::kManifestName);
 
-  CreateNewManifestFile();
-  const auto& size = FileTool::GetFileSize(manifest_name);
+namespace {
+// record的解析结果
+enum class RecordStatus { kOk, kIncomplete, kCorruption };
+// 将payload封装成带crc校验的record
+void EncodeRecord(const std::string& payload, std::string* out) {
+  util::PutFixed32(out, crc32::Mask(crc32::Value(payload.data(),
+                                                 payload.size())));
+  util::PutFixed32(out, payload.size());
+  out->append(payload);
+}
+// 从input中解析出一条record，header或者payload超出文件末尾返回kIncomplete，
+// 校验失败返回kCorruption，解析失败时input保持不变
+RecordStatus DecodeRecord(std::string_view* input,
+                          std::string_view* payload) {
+  if (input->size() < ManifestOptions::kManifestRecordHeaderSize) {
+    return RecordStatus::kIncomplete;
+  }
+  const uint32_t crc = crc32::Unmask(util::DecodeFixed32(input->data()));
+  const uint32_t length = util::DecodeFixed32(input->data() + 4);
+  if (input->size() - ManifestOptions::kManifestRecordHeaderSize < length) {
+    return RecordStatus::kIncomplete;
+  }
+  *payload = std::string_view(
+      input->data() + ManifestOptions::kManifestRecordHeaderSize, length);
+  if (crc32::Value(payload->data(), payload->size()) != crc) {
+    return RecordStatus::kCorruption;
+  }
+  input->remove_prefix(ManifestOptions::kManifestRecordHeaderSize + length);
+  return RecordStatus::kOk;
+}
+void EncodeLogHeader(std::string* out) {
+  util::PutFixed32(out, ManifestOptions::kManifestLogMagic);
+  util::PutFixed32(out, ManifestOptions::kManifestLogVersion);
+}
+// 校验失败的record是否可以当作日志尾部丢弃：
+// 1. 它是最后一条record，说明是写到一半崩溃了
+// 2. 日志被复用过(有快照)，复用的日志尾部本来就残留着旧record的片段，
+//    按照length跳过之后如果紧跟着一条快照之后的record，说明是日志中间损坏；
+//    length本身损坏时无法和旧record的片段区分，只能当作尾部处理
+bool IsDroppableTail(std::string_view input, uint64_t snapshot_sequence) {
+  const uint32_t length = util::DecodeFixed32(input.data() + 4);
+  input.remove_prefix(ManifestOptions::kManifestRecordHeaderSize + length);
+  if (input.empty()) {
+    return true;
+  }
+  if (snapshot_sequence == 0) {
+    return false;
+  }
+  std::string_view payload;
+  uint64_t sequence = 0;
+  return DecodeRecord(&input, &payload) != RecordStatus::kOk ||
+         !util::GetVarint64(&payload, &sequence) ||
+         sequence <= snapshot_sequence;
+}
+bool ReadWholeFile(const std::string& file_name, std::string* content) {
+  const auto& size = FileTool::GetFileSize(file_name);
+  content->resize(size);
   if (size == 0) {
+    return true;
+  }
+  FileReader file_reader(file_name);
+  return file_reader.Read(0, size, content) == Status::kSuccess;
+}
+}  // namespace
+
+ManifestHandler::ManifestHandler(const std::string& db_path)
+    : db_path_(db_path), writers_cv_(&mutex_), background_cv_(&mutex_) {
+  background_thread_ = std::thread(&ManifestHandler::BackgroundReWrite, this);
+}
+ManifestHandler::~ManifestHandler() {
+  {
+    ScopedLockImpl<MutexLock> lock_guard(mutex_);
+    shutting_down_ = true;
+    background_cv_.SignalAll();
+  }
+  if (background_thread_.joinable()) {
+    background_thread_.join();
+  }
+  if (manifest_writer_) {
+    manifest_writer_->Close();
+  }
+}
+// db_path：参数是db路径，该参数应该是db::Open参数设置的
+bool ManifestHandler::OpenManifestFile() {
+  const auto& manifest_rewrite_name = FileName::DescriptorFileName(
+      db_path_, ManifestOptions::kManifestRewriteFilename);
+  // 没有rename成功的快照可能是不完整的，直接丢弃
+  if (FileTool::Exist(manifest_rewrite_name)) {
+    FileTool::RemoveFile(manifest_rewrite_name);
+  }
+  ScopedLockImpl<MutexLock> lock_guard(mutex_);
+  CreateNewManifestFile();
+  if (!LoadSnapshotFile() || !ReplayManifestFile()) {
     return false;
   }
-  FileReader file_reader(manifest_name);
+  return OpenManifestWriter(false);
+}
+// 加载快照，快照是通过rename原子生成的，校验失败说明文件损坏
+bool ManifestHandler::LoadSnapshotFile() {
+  const auto& snapshot_name = FileName::DescriptorFileName(
+      db_path_, ManifestOptions::kManifestSnapshotName);
+  if (!FileTool::Exist(snapshot_name)) {
+    return true;
+  }
   std::string content;
-  file_reader.Read(0, size, &content);
+  if (!ReadWholeFile(snapshot_name, &content)) {
+    return false;
+  }
+  std::string_view input = content;
+  std::string_view payload;
+  if (DecodeRecord(&input, &payload) != RecordStatus::kOk ||
+      !util::GetVarint64(&payload, &snapshot_sequence_)) {
+    LOG(ERROR, "manifest snapshot is corrupted!");
+    return false;
+  }
   ManifestChangeEdit manifest_change_edit;
-  manifest_change_edit.DecodeTo(content);
+  manifest_change_edit.DecodeTo(std::string(payload));
   manifest_change_edit.ApplyChangeSet(manifest_);
+  // 快照中的都是当前存活的sst
+  manifest_.creations = manifest_.table_levels_map.size();
+  manifest_.deletions = 0;
+  last_sequence_ = snapshot_sequence_;
+  return true;
+}
+// 重放快照之后的增量日志
+bool ManifestHandler::ReplayManifestFile() {
+  const auto& manifest_name =
+      FileName::DescriptorFileName(db_path_, ManifestOptions::kManifestName);
+  std::string content;
+  if (!ReadWholeFile(manifest_name, &content)) {
+    return false;
+  }
+  log_records_ = 0;
+  log_size_ = 0;
+  std::string header;
+  EncodeLogHeader(&header);
+  if (content.size() < header.size() &&
+      header.compare(0, content.size(), content) == 0) {
+    // 文件头没有写完整就崩溃了，日志中还没有任何record
+    if (!content.empty()) {
+      LOG(WARN, "drop torn manifest header, size[%lu]", content.size());
+      return FileTool::Truncate(manifest_name, 0);
+    }
+    return true;
+  }
+  // 旧版本的manifest没有文件头，不能当作损坏的日志截断掉
+  if (content.compare(0, header.size(), header) != 0) {
+    LOG(ERROR, "unsupported manifest format, file[%s]",
+        manifest_name.c_str());
+    return false;
+  }
+  std::string_view input = content;
+  input.remove_prefix(header.size());
+  while (!input.empty()) {
+    std::string_view payload;
+    const auto status = DecodeRecord(&input, &payload);
+    if (status == RecordStatus::kIncomplete) {
+      break;
+    }
+    if (status == RecordStatus::kCorruption) {
+      if (!IsDroppableTail(input, snapshot_sequence_)) {
+        LOG(ERROR, "manifest record checksum mismatch, offset[%lu]",
+            content.size() - input.size());
+        return false;
+      }
+      break;
+    }
+    uint64_t sequence = 0;
+    if (!util::GetVarint64(&payload, &sequence)) {
+      LOG(ERROR, "manifest record is corrupted, offset[%lu]",
+          content.size() - input.size());
+      return false;
+    }
+    // 生成快照之后，清空增量日志之前崩溃，这部分已经包含在快照中了；
+    // 复用的日志在新record之后可能还残留着旧的record，同样跳过
+    if (sequence <= snapshot_sequence_) {
+      continue;
+    }
+    std::string_view edit;
+    while (util::GetLengthPrefixedSlice(&payload, &edit)) {
+      ManifestChangeEdit manifest_change_edit;
+      manifest_change_edit.DecodeTo(std::string(edit));
+      manifest_change_edit.ApplyChangeSet(manifest_);
+    }
+    last_sequence_ = sequence;
+    ++log_records_;
+  }
+  log_size_ = content.size() - input.size();
+  // 尾部不完整的record需要截断，否则后面追加的record无法被重放
+  if (!input.empty()) {
+    LOG(WARN, "drop manifest tail, size[%lu]", input.size());
+    if (!FileTool::Truncate(manifest_name, log_size_)) {
+      return false;
+    }
+  }
   return true;
 }
-bool ManifestHandler::RecoverFromReWriteManifestFile() {
-  // 如果manifest文件不存在，那么我们从rewrite_manifest中恢复出来
+// 先写临时文件再rename，保证快照文件总是完整的
+bool ManifestHandler::WriteSnapshotFile() {
   const auto& manifest_rewrite_name = FileName::DescriptorFileName(
       db_path_, ManifestOptions::kManifestRewriteFilename);
-  // 将当前的manifest序列化之后追加到rewrite中
   ManifestChangeEdit manifest_change_edit;
   manifest_change_edit.ParseFromManifest(manifest_);
-  std::string current_manifest_str;
+  std::string payload;
+  util::PutVarint64(&payload, last_sequence_);
   manifest_change_edit.EncodeTo(manifest_change_edit.GetManifestChanages(),
-                                &current_manifest_str);
-  if (!current_manifest_str.empty()) {
-    FileWriter file_writer(manifest_rewrite_name, true);
-    file_writer.Append(current_manifest_str.data(),
-                       current_manifest_str.size());
-    file_writer.Sync();
+                                &payload);
+  std::string record;
+  EncodeRecord(payload, &record);
+  {
+    FileWriter file_writer(manifest_rewrite_name, false);
+    if (file_writer.Append(record.data(), record.size()) !=
+            Status::kSuccess ||
+        file_writer.Sync() != Status::kSuccess) {
+      file_writer.Close();
+      return false;
+    }
     file_writer.Close();
   }
-  const auto& manifest_name =
-      FileName::DescriptorFileName(db_path_, ManifestOptions::kManifestName);
-
-  return FileTool::Rename(manifest_rewrite_name, manifest_name);
+  const auto& snapshot_name = FileName::DescriptorFileName(
+      db_path_, ManifestOptions::kManifestSnapshotName);
+  // 目录落盘之后新快照才是持久的，在这之前不能清空或者复用增量日志，
+  // 否则掉电之后可能只剩下旧的快照，而增量日志已经被覆盖了
+  return FileTool::Rename(manifest_rewrite_name, snapshot_name) &&
+         FileTool::SyncDir(db_path_);
 }
 void ManifestHandler::CreateNewManifestFile() {
   // 创建一个新的对象
   manifest_.Clear();
+  last_sequence_ = 0;
+  snapshot_sequence_ = 0;
+  log_records_ = 0;
+  log_size_ = 0;
 }
-
-bool ManifestHandler::ReWrite() {
-  const auto code = RecoverFromReWriteManifestFile();
-  if (!code) {
-    return code;
+bool ManifestHandler::OpenManifestWriter(bool truncate) {
+  if (manifest_writer_) {
+    manifest_writer_->Close();
+  }
+  const auto& manifest_name =
+      FileName::DescriptorFileName(db_path_, ManifestOptions::kManifestName);
+  // 清空日志时复用原来的文件从头覆盖，追加的record不用再分配空间，
+  // Sync时也不需要更新文件大小
+  FileWriterOptions options;
+  options.append = !truncate;
+  options.recycle = truncate;
+  options.preallocate_size = ManifestOptions::kManifestPreallocateSize;
+  manifest_writer_ = std::make_unique<FileWriter>(manifest_name, options);
+  if (truncate) {
+    log_records_ = 0;
+    log_size_ = 0;
+  }
+  // 新的日志先写文件头，和后面第一条record一起Sync
+  if (log_size_ == 0) {
+    std::string header;
+    EncodeLogHeader(&header);
+    if (manifest_writer_->Append(header.data(), header.size()) !=
+        Status::kSuccess) {
+      LOG(ERROR, "write manifest header failed!");
+      manifest_writer_->Close();
+      manifest_writer_.reset();
+      return false;
+    }
+    log_size_ = header.size();
   }
-  manifest_.creations = manifest_.table_levels_map.size();
-  manifest_.deletions = 0;
   return true;
 }
-// 该函数是否需要加锁，在后续逻辑会进行补充
+bool ManifestHandler::TruncateManifestLog(uint64_t log_size) {
+  manifest_writer_->Close();
+  manifest_writer_.reset();
+  const auto& manifest_name =
+      FileName::DescriptorFileName(db_path_, ManifestOptions::kManifestName);
+  if (!FileTool::Truncate(manifest_name, log_size)) {
+    return false;
+  }
+  // 按追加模式重新打开，从截断的位置继续写
+  return OpenManifestWriter(false);
+}
+bool ManifestHandler::NeedReWrite() const {
+  if (log_records_ > ManifestOptions::kManifestSnapshotRecordThreshold ||
+      log_size_ > ManifestOptions::kManifestSnapshotLogSizeThreshold) {
+    return true;
+  }
+  return manifest_.deletions >
+             ManifestOptions::kManifestDeletionsRewriteThreshold &&
+         manifest_.deletions > ManifestOptions::kManifestDeletionsRatio *
+                                   (manifest_.creations - manifest_.deletions);
+}
+
+bool ManifestHandler::ReWrite() {
+  ManifestWriter writer;
+  writer.rewrite = true;
+  return CommitWriter(&writer);
+}
 bool ManifestHandler::AddChanges(const std::string& input) {
   if (input.empty()) {
     return false;
   }
-  ManifestChangeEdit manifest_change_edit;
-  manifest_change_edit.DecodeTo(input);
-  manifest_change_edit.ApplyChangeSet(manifest_);
-  if (manifest_.deletions >
-          ManifestOptions::kManifestDeletionsRewriteThreshold &&
-      manifest_.deletions > ManifestOptions::kManifestDeletionsRatio *
-                                (manifest_.creations - manifest_.deletions)) {
-    if (!ReWrite()) {
-      return false;
+  ManifestWriter writer;
+  writer.edit = input;
+  return CommitWriter(&writer);
+}
+
+bool ManifestHandler::CommitWriter(ManifestWriter* writer) {
+  ScopedLockImpl<MutexLock> lock_guard(mutex_);
+  writers_.push_back(writer);
+  // 前面的leader可能已经帮我们写完了
+  while (!writer->done && writer != writers_.front()) {
+    writers_cv_.Wait();
+  }
+  if (writer->done) {
+    return writer->success;
+  }
+  // 当前writer成为leader，队列头部的writer拥有manifest文件的独占写权限
+  bool success = true;
+  if (!manifest_writer_ && !log_broken_ && !OpenManifestWriter(false)) {
+    log_broken_ = true;
+  }
+  if (writer->rewrite) {
+    // rewrite期间其他writer都在排队，因此manifest_不会被修改
+    mutex_.UnLock();
+    success = WriteSnapshotFile();
+    mutex_.Lock();
+    if (success) {
+      // 快照已经落盘，增量日志可以清空了
+      snapshot_sequence_ = last_sequence_;
+      // 文件头写入失败时拒绝写入，等待下一次rewrite
+      log_broken_ = !OpenManifestWriter(true);
+      manifest_.creations = manifest_.table_levels_map.size();
+      manifest_.deletions = 0;
     }
+    writer->success = success;
+    writer->done = true;
+    writers_.pop_front();
+    writers_cv_.SignalAll();
+    return success;
+  }
+  // 合并队列中的edit，遇到rewrite请求就停下来
+  std::string payload;
+  util::PutVarint64(&payload, last_sequence_ + 1);
+  ManifestWriter* last_writer = writer;
+  for (auto* item : writers_) {
+    if (item->rewrite ||
+        (item != writer && payload.size() + item->edit.size() >
+                               ManifestOptions::kManifestMaxBatchSize)) {
+      break;
+    }
+    util::PutLengthPrefixedSlice(&payload, item->edit);
+    last_writer = item;
+  }
+  std::string record;
+  EncodeRecord(payload, &record);
+  // 日志尾部有无法截断的残留数据，追加的record重放时会被丢弃，
+  // 在rewrite清空日志之前拒绝写入
+  if (log_broken_ || !manifest_writer_) {
+    success = false;
   } else {
+    // 写盘期间释放锁，后来的writer可以继续排队
+    const uint64_t log_size = log_size_;
+    bool truncated = true;
+    mutex_.UnLock();
+    if (manifest_writer_->Append(record.data(), record.size()) !=
+            Status::kSuccess ||
+        manifest_writer_->Sync() != Status::kSuccess) {
+      success = false;
+      // 失败时尾部可能已经写入了半条record，截断回最后一条完整的record
+      truncated = TruncateManifestLog(log_size);
+    }
+    mutex_.Lock();
+    if (!truncated) {
+      LOG(ERROR, "truncate manifest failed, reject writes until rewrite");
+      log_broken_ = true;
+    }
+  }
+  if (success) {
+    ++last_sequence_;
+    ++log_records_;
+    log_size_ += record.size();
+  }
+  // 落盘之后才修改内存中的manifest
+  while (true) {
+    ManifestWriter* ready = writers_.front();
+    writers_.pop_front();
+    if (success) {
+      ManifestChangeEdit manifest_change_edit;
+      manifest_change_edit.DecodeTo(ready->edit);
+      manifest_change_edit.ApplyChangeSet(manifest_);
+    }
+    ready->success = success;
+    ready->done = true;
+    if (ready == last_writer) {
+      break;
+    }
+  }
+  // 日志无法截断时通过快照清空增量日志
+  if ((log_broken_ || NeedReWrite()) && !rewrite_scheduled_) {
+    // 由后台线程生成快照，不阻塞当前的flush/compaction
+    rewrite_scheduled_ = true;
+    background_cv_.SignalAll();
+  }
+  writers_cv_.SignalAll();
+  return success;
+}
 
-    // 那么说明当前的manifest文件并不是很大，直接追加到当前的manifest文件中
-    const auto& manifest_name =
-        FileName::DescriptorFileName(db_path_, ManifestOptions::kManifestName);
-      LOG(WARN,"manifest_name=%s", manifest_name.c_str());
-
-    FileWriter file_writer(manifest_name, true);
-    file_writer.Append(input.data(), input.size());
-    file_writer.Sync();
-    file_writer.Close();
+void ManifestHandler::BackgroundReWrite() {
+  while (true) {
+    {
+      ScopedLockImpl<MutexLock> lock_guard(mutex_);
+      while (!rewrite_scheduled_ && !shutting_down_) {
+        background_cv_.Wait();
+      }
+      if (shutting_down_) {
+        return;
+      }
+    }
+    if (!ReWrite()) {
+      LOG(ERROR, "background rewrite manifest failed!");
+    }
+    ScopedLockImpl<MutexLock> lock_guard(mutex_);
+    rewrite_scheduled_ = false;
   }
-  return true;
 }
 
 bool ManifestHandler::AddTableMeta(int32_t level, int64_t sst_id) {
+  return AddTableMeta(level, sst_id, TableManifest());
+}
+
+bool ManifestHandler::AddTableMeta(int32_t level, int64_t sst_id,
+                                   const TableManifest& table_meta) {
   std::vector<ManifestChanage> manifest_changes;
   ManifestChanage manifest_change;
   manifest_change.id = sst_id;
   manifest_change.level = level;
-  manifest_changes.emplace_back(manifest_change);
+  manifest_change.file_size = table_meta.file_size;
+  manifest_change.entry_num = table_meta.entry_num;
+  manifest_change.smallest_seq = table_meta.smallest_seq;
+  manifest_change.largest_seq = table_meta.largest_seq;
+  manifest_change.smallest_key = table_meta.smallest_key;
+  manifest_change.largest_key = table_meta.largest_key;
+  manifest_changes.emplace_back(std::move(manifest_change));
   ManifestChangeEdit manifest_change_edit;
   std::string current_manifest_str;
   manifest_change_edit.EncodeTo(manifest_changes, &current_manifest_str);
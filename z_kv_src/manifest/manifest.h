@@ -1,16 +1,33 @@
 #pragma once
+#include <deque>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <thread>
 #include <vector>
+
+#include "../file/file.h"
+#include "../utils/mutex.h"
 namespace z_kv {
 class options;
 
 // 记录的是manifest中sst元数据信息
 struct TableManifest {
-  uint32_t level;
+  uint32_t level = 0;
   // crc_sum留作扩展
-  uint64_t crc_sum;
+  uint64_t crc_sum = 0;
+  // sst文件大小
+  uint64_t file_size = 0;
+  // sst中kv的条数
+  uint64_t entry_num = 0;
+  // sst中数据的序列号范围
+  uint64_t smallest_seq = 0;
+  uint64_t largest_seq = 0;
+  // sst中最小和最大的key，用于查询和压缩时的文件裁剪
+  std::string smallest_key;
+  std::string largest_key;
 };
 // manifest：主要用于内存中使用
 struct Manifest {
@@ -18,6 +35,9 @@ struct Manifest {
   std::vector<std::unordered_set<uint64_t>> level_tables_map;
   //某个sst属于哪一层,主要用于加速查询的作用
   std::unordered_map<uint64_t, TableManifest> table_levels_map;
+  // 每一层按照smallest_key排好序的sst，L1及以上层内sst的key范围互不重叠，
+  // 因此可以直接二分查找，不需要打开sst文件
+  std::vector<std::vector<uint64_t>> level_sorted_tables;
   // 创建操作次数
   int32_t creations = 0;
   // 删除次数
@@ -25,28 +45,87 @@ struct Manifest {
   void Clear() {
     level_tables_map.clear();
     table_levels_map.clear();
+    level_sorted_tables.clear();
     creations = 0;
     deletions = 0;
   }
+  // 重新对某一层的sst进行排序，ApplyChangeSet之后调用
+  void SortLevel(uint32_t level);
+  // 在L1及以上的某一层中二分查找可能包含key的sst，没有返回false
+  bool FindTable(uint32_t level, const std::string_view& key,
+                 uint64_t* sst_id) const;
+  // 获取某一层中和[smallest, largest]有重叠的sst，主要用于压缩时选择文件
+  void GetOverlappingTables(uint32_t level, const std::string_view& smallest,
+                            const std::string_view& largest,
+                            std::vector<uint64_t>* sst_ids) const;
 };
 // 主要是用来读写manifest文件
+// 磁盘上由两部分组成：
+// 1. SNAPSHOTMANIFEST：某个时刻完整版本的快照，|record(sequence|edit)|
+// 2. MANIFEST：快照之后的增量日志，|magic|version|之后是一条条带crc校验的record
+// record格式：|crc(fixed32)|length(fixed32)|payload|
+// 增量日志payload：|sequence(varint64)|多个length-prefixed的edit|
+// 并发提交的edit会被合并成一条record，只需要一次fsync(group commit)
+// 启动时先加载快照，然后只重放sequence大于快照的增量日志
 class ManifestHandler {
  public:
   ManifestHandler(const std::string& db_path);
+  ~ManifestHandler();
   bool OpenManifestFile();
+  // 生成新的快照并清空增量日志
   bool ReWrite();
   //
   bool AddChanges(const std::string& input);
   bool AddTableMeta(int32_t level, int64_t sst_id);
+  // 带有sst元数据信息的版本，flush和compaction生成新的sst时使用
+  bool AddTableMeta(int32_t level, int64_t sst_id,
+                    const TableManifest& table_meta);
   bool RevertToManifest(const std::unordered_set<uint64_t>& delete_sst_ids);
   const Manifest& GetManifest() { return manifest_; }
 
  private:
+  // 等待写入manifest的请求，rewrite也作为一个请求排队，保证和写入互斥
+  struct ManifestWriter {
+    std::string edit;
+    bool rewrite = false;
+    bool done = false;
+    bool success = false;
+  };
   void CreateNewManifestFile();
-  bool RecoverFromReWriteManifestFile();
+  bool LoadSnapshotFile();
+  bool WriteSnapshotFile();
   bool ReplayManifestFile();
+  // 需要持有mutex_
+  bool NeedReWrite() const;
+  bool OpenManifestWriter(bool truncate);
+  // 写入失败之后把增量日志截断到log_size并重新打开，leader调用
+  bool TruncateManifestLog(uint64_t log_size);
+  // 排队等待成为leader，由leader负责合并写入
+  bool CommitWriter(ManifestWriter* writer);
+  // 后台rewrite线程
+  void BackgroundReWrite();
+
  private:
   Manifest manifest_;
   std::string db_path_;
+  // 长期持有的manifest文件句柄，避免每次写入都open/close
+  std::unique_ptr<FileWriter> manifest_writer_;
+  // 最后一条增量record的序列号
+  uint64_t last_sequence_ = 0;
+  // 快照包含的最大序列号
+  uint64_t snapshot_sequence_ = 0;
+  // 快照之后增量日志的条数和大小
+  uint64_t log_records_ = 0;
+  uint64_t log_size_ = 0;
+  // 写入失败之后没能截断日志，rewrite完成之前拒绝写入
+  bool log_broken_ = false;
+  MutexLock mutex_;
+  CondVar writers_cv_;
+  std::deque<ManifestWriter*> writers_;
+  // 后台rewrite相关
+  CondVar background_cv_;
+  bool rewrite_scheduled_ = false;
+  bool shutting_down_ = false;
+  std::thread background_thread_;
 };
 }  // namespace corekv
@@ -10,11 +10,17 @@ using namespace z_kv::util;
 void ManifestChangeEdit::ParseFromManifest(const Manifest& manifest) {
   const auto table_size = manifest.table_levels_map.size();
   if (table_size > 0) {
-    manifest_changes_.resize(table_size);
+    manifest_changes_.reserve(table_size);
     for (const auto& item : manifest.table_levels_map) {
       ManifestChanage manifest_change;
       manifest_change.id = item.first;
       manifest_change.level = item.second.level;
+      manifest_change.file_size = item.second.file_size;
+      manifest_change.entry_num = item.second.entry_num;
+      manifest_change.smallest_seq = item.second.smallest_seq;
+      manifest_change.largest_seq = item.second.largest_seq;
+      manifest_change.smallest_key = item.second.smallest_key;
+      manifest_change.largest_key = item.second.largest_key;
       // 就地构造，比std::move性能会更高
       manifest_changes_.emplace_back(manifest_change);
     }
@@ -32,6 +38,15 @@ void ManifestChangeEdit::EncodeTo(
 
       // 这里是变长32位，空间压缩比很高
       PutVarint32(out, item.manifest_change_type);
+      // 删除操作只需要id即可，创建操作需要带上sst的元数据
+      if (item.manifest_change_type == ManifestChanageOpType::kCreate) {
+        PutVarint64(out, item.file_size);
+        PutVarint64(out, item.entry_num);
+        PutVarint64(out, item.smallest_seq);
+        PutVarint64(out, item.largest_seq);
+        PutLengthPrefixedSlice(out, item.smallest_key);
+        PutLengthPrefixedSlice(out, item.largest_key);
+      }
     }
   }
 }
@@ -48,26 +63,56 @@ void ManifestChangeEdit::DecodeTo(const std::string& input) {
     uint64_t id = 0;
     uint32_t level = 0;
     uint32_t change_op_type = 0;
-    if (GetVarint64(&st, &id) && GetVarint32(&st, &level) &&
-        GetVarint32(&st, &change_op_type)) {
-      ManifestChanage manifest_change;
-      manifest_change.id = id;
-      manifest_change.level = level;
-      manifest_change.manifest_change_type = (ManifestChanageOpType)change_op_type;
-      manifest_changes_.emplace_back(manifest_change);
+    if (!GetVarint64(&st, &id) || !GetVarint32(&st, &level) ||
+        !GetVarint32(&st, &change_op_type)) {
+      LOG(WARN, "decode manifest change failed, index[%u]!", index);
+      return;
     }
+    ManifestChanage manifest_change;
+    manifest_change.id = id;
+    manifest_change.level = level;
+    manifest_change.manifest_change_type = (ManifestChanageOpType)change_op_type;
+    if (manifest_change.manifest_change_type ==
+        ManifestChanageOpType::kCreate) {
+      std::string_view smallest_key, largest_key;
+      if (!GetVarint64(&st, &manifest_change.file_size) ||
+          !GetVarint64(&st, &manifest_change.entry_num) ||
+          !GetVarint64(&st, &manifest_change.smallest_seq) ||
+          !GetVarint64(&st, &manifest_change.largest_seq) ||
+          !GetLengthPrefixedSlice(&st, &smallest_key) ||
+          !GetLengthPrefixedSlice(&st, &largest_key)) {
+        LOG(WARN, "decode table meta failed, id[%lu]!", id);
+        return;
+      }
+      manifest_change.smallest_key.assign(smallest_key.data(),
+                                          smallest_key.size());
+      manifest_change.largest_key.assign(largest_key.data(),
+                                         largest_key.size());
+    }
+    manifest_changes_.emplace_back(std::move(manifest_change));
   }
 }
 void ManifestChangeEdit::ApplyChangeSet(Manifest& manifest) {
+  // 记录本次修改涉及到的层，最后统一重新排序
+  std::vector<bool> dirty_levels(manifest.level_tables_map.size(), false);
   for (const auto& item : manifest_changes_) {
     switch (item.manifest_change_type) {
       case ManifestChanageOpType::kCreate: {
-        manifest.table_levels_map[item.id].level = item.level;
+        auto& table_meta = manifest.table_levels_map[item.id];
+        table_meta.level = item.level;
+        table_meta.file_size = item.file_size;
+        table_meta.entry_num = item.entry_num;
+        table_meta.smallest_seq = item.smallest_seq;
+        table_meta.largest_seq = item.largest_seq;
+        table_meta.smallest_key = item.smallest_key;
+        table_meta.largest_key = item.largest_key;
         // item.level中的level下标可能是0也有可能是1，这里+1保证安全
-        if (manifest.level_tables_map.size() < item.level) {
+        if (manifest.level_tables_map.size() <= item.level) {
           manifest.level_tables_map.resize(item.level + 1);
+          dirty_levels.resize(item.level + 1, false);
         }
         manifest.level_tables_map[item.level].insert(item.id);
+        dirty_levels[item.level] = true;
         ++manifest.creations;
         break;
       }
@@ -77,12 +122,15 @@ void ManifestChangeEdit::ApplyChangeSet(Manifest& manifest) {
         if (iter == manifest.table_levels_map.cend()) {
           LOG(WARN, "don't find id[%ld] in manifest.table_levels_map!",
               item.id);
-          return;
+          break;
         }
-        if (manifest.level_tables_map.size() < iter->second.level) {
-          manifest.level_tables_map[iter->second.level].erase(item.id);
-          manifest.table_levels_map.erase(item.id);
+        const auto level = iter->second.level;
+        if (level < manifest.level_tables_map.size()) {
+          manifest.level_tables_map[level].erase(item.id);
+          dirty_levels[level] = true;
         }
+        manifest.table_levels_map.erase(iter);
+        ++manifest.deletions;
         break;
       }
       default:
@@ -90,5 +138,10 @@ void ManifestChangeEdit::ApplyChangeSet(Manifest& manifest) {
         break;
     }
   }
+  for (uint32_t level = 0; level < dirty_levels.size(); ++level) {
+    if (dirty_levels[level]) {
+      manifest.SortLevel(level);
+    }
+  }
 }
 }  // namespace corekv
\ No newline at end of file
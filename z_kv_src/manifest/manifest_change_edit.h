@@ -10,6 +10,13 @@ struct ManifestChanage {
   uint32_t level;
   // 默认为创建
   ManifestChanageOpType manifest_change_type = ManifestChanageOpType::kCreate;
+  // 以下为sst的元数据，只有kCreate类型才会序列化
+  uint64_t file_size = 0;
+  uint64_t entry_num = 0;
+  uint64_t smallest_seq = 0;
+  uint64_t largest_seq = 0;
+  std::string smallest_key;
+  std::string largest_key;
 };
 
 class ManifestChangeEdit {
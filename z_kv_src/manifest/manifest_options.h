@@ -9,7 +9,23 @@ namespace ManifestOptions {
   // manifest后缀名
   static const std::string kManifestName = "MANIFEST";
   static const std::string kManifestRewriteFilename = "REWRITEMANIFEST";
+  // manifest快照，保存某个时刻完整的版本信息
+  static const std::string kManifestSnapshotName = "SNAPSHOTMANIFEST";
   static constexpr uint32_t kManifestDeletionsRewriteThreshold = 10000;
   static constexpr uint32_t kManifestDeletionsRatio = 10;
+  // record头部：crc(fixed32) + length(fixed32)
+  static constexpr uint32_t kManifestRecordHeaderSize = 8;
+  // 增量日志的文件头：magic(fixed32) + version(fixed32)，
+  // 旧版本的manifest没有文件头，不能按照record的格式解析
+  static constexpr uint32_t kManifestLogMagic = 0x4d564b5a;
+  static constexpr uint32_t kManifestLogVersion = 1;
+  static constexpr uint32_t kManifestLogHeaderSize = 8;
+  // 一次group commit最多合并的数据量
+  static constexpr uint32_t kManifestMaxBatchSize = 1 << 20;
+  // 增量日志超过一定的条数或者大小就生成一次新的快照，保证启动时间稳定
+  static constexpr uint32_t kManifestSnapshotRecordThreshold = 4096;
+  static constexpr uint64_t kManifestSnapshotLogSizeThreshold = 4 << 20;
+  // 增量日志每次预分配的大小
+  static constexpr uint64_t kManifestPreallocateSize = 1 << 20;
 };
 }  // namespace corekv
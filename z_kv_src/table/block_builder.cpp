@@ -1,6 +1,10 @@
 #include "block_builder.h"
 
+#include <algorithm>
+
 #include "../utils/codec.h"
+#include "../utils/hash_util.h"
+#include "table_options.h"
 namespace z_kv {
 using namespace util;
 
@@ -18,9 +22,40 @@ void DataBlockBuilder::AddRestartPointers() {
   for (const auto& restart : restarts_) {
     PutFixed32(&buffer_, restart);
   }
-  PutFixed32(&buffer_, restarts_.size());
+  uint32_t num_restarts = restarts_.size();
+  if (UseHashIndex()) {
+    // 把hash索引追加到restart后面，相同bucket中有多个key时标记为冲突，查询时退化为二分查找
+    const uint32_t bucket_num = HashBucketNum();
+    std::vector<uint16_t> buckets(bucket_num, kHashBucketEmpty);
+    for (const auto& [hash, position] : hash_entries_) {
+      uint16_t& bucket = buckets[hash % bucket_num];
+      bucket = bucket == kHashBucketEmpty ? position : kHashBucketCollision;
+    }
+    for (const auto& bucket : buckets) {
+      buffer_.push_back(static_cast<char>(bucket & 0xff));
+      buffer_.push_back(static_cast<char>(bucket >> 8));
+    }
+    PutFixed32(&buffer_, bucket_num);
+    num_restarts |= kDataBlockHashIndexFlag | kDataBlockHash64Flag;
+  }
+  PutFixed32(&buffer_, num_restarts);
   is_finished_ = true;
 }
+bool DataBlockBuilder::UseHashIndex() const {
+  return options_->data_block_hash_ratio > 0 && !hash_entries_.empty() &&
+         restarts_.size() <= kMaxHashIndexRestarts &&
+         options_->block_restart_interval <= kMaxHashIndexRestartInterval;
+}
+uint32_t DataBlockBuilder::HashBucketNum() const {
+  return static_cast<uint32_t>(hash_entries_.size() /
+                               options_->data_block_hash_ratio) + 1;
+}
+uint64_t DataBlockBuilder::HashIndexSize() const {
+  if (!UseHashIndex()) {
+    return 0;
+  }
+  return HashBucketNum() * sizeof(uint16_t) + sizeof(uint32_t);
+}
 //结束本datablock,添加restart数据，并设置结束标志
 void DataBlockBuilder::Finish() { AddRestartPointers(); }
 //向datablock中添加数据，每16条数据记一片，片内的key进行公共前缀压缩，片偏移量记录到restarts
@@ -58,13 +93,21 @@ void DataBlockBuilder::Add(const std::string_view& key,
   buffer_.append(value.data(), value_size);
   // 更新pre_key，深拷贝
   pre_key_.assign(key.data(), current_key_size);
+  if (options_->data_block_hash_ratio > 0) {
+    const uint16_t position =
+        ((restarts_.size() - 1) << 8) | (restart_pointer_counter_ & 0xff);
+    hash_entries_.emplace_back(
+        static_cast<uint32_t>(hash_util::Hash64(key.data(), key.size())),
+        position);
+  }
   ++restart_pointer_counter_;
 }
 
 
 
 // 构造函数，传入option为了获取布隆过滤器的设置
-FilterBlockBuilder::FilterBlockBuilder(const Options& options) {
+FilterBlockBuilder::FilterBlockBuilder(const Options& options)
+    : base_lg_(std::min<uint32_t>(options.filter_base_lg, 31)) {
   if (options.filter_policy) {
     policy_filter_ = options.filter_policy.get();
   }
@@ -74,14 +117,16 @@ void FilterBlockBuilder::Add(const std::string_view& key) {
   if (key.empty() || !Availabe()) {
     return;
   }
-  datas_.emplace_back(key);
-}
-//创建布隆过滤器
-void FilterBlockBuilder::CreateFilter() {
-  if (!Availabe() || datas_.empty()) {
+  const uint64_t hash = hash_util::Hash64(key.data(), key.size());
+  // 同一个block中连续相同的key(例如同一个user key的多个版本)只需要一个
+  if (hashes_.size() > block_hash_begin_ && hashes_.back() == hash) {
     return;
   }
-  policy_filter_->CreateFilter(&datas_[0], datas_.size());
+  hashes_.push_back(hash);
+}
+uint64_t FilterBlockBuilder::FinishBlock() {
+  block_hash_begin_ = hashes_.size();
+  return KeyNum();
 }
 //查询key是否存在
 bool FilterBlockBuilder::MayMatch(const std::string_view& key) {
@@ -99,14 +144,46 @@ bool FilterBlockBuilder::MayMatch(const std::string_view& key,
 }
 //返回构建好的FilterBlock
 const std::string& FilterBlockBuilder::Data() { return buffer_; }
-//构建布隆过滤器，并将hash函数个数记录到到布隆过滤器最后（把key准备好后才调用）
+void FilterBlockBuilder::AddBlock(uint64_t block_offset, uint64_t key_end) {
+  if (!Availabe()) {
+    return;
+  }
+  const uint64_t filter_index = block_offset >> base_lg_;
+  // 之前的key都属于前面的偏移区间，中间跳过的区间生成空filter
+  while (filter_index > filter_offsets_.size()) {
+    GenerateFilter();
+  }
+  block_key_end_ = key_end;
+}
+void FilterBlockBuilder::GenerateFilter() {
+  filter_offsets_.push_back(buffer_.size());
+  FinishPartition(block_key_end_, &buffer_);
+}
+//构建filter block，只有已经通过AddBlock确定了位置的key才会生成filter（把block都落盘后才调用）
 void FilterBlockBuilder::Finish() {
-  if (Availabe() && !datas_.empty()) {
-    // 先构建布隆过滤器
-    CreateFilter();
-    // // 序列化hash个数和bf本身数据
-    buffer_ = policy_filter_->Data();
-    util::PutFixed32(&buffer_, policy_filter_->GetMeta().hash_num);
+  if (!Availabe()) {
+    return;
+  }
+  if (block_key_end_ > partitioned_key_num_) {
+    GenerateFilter();
+  }
+  const uint32_t array_offset = buffer_.size();
+  for (const auto filter_offset : filter_offsets_) {
+    PutFixed32(&buffer_, filter_offset);
+  }
+  PutFixed32(&buffer_, array_offset);
+  buffer_.push_back(static_cast<char>(base_lg_));
+}
+void FilterBlockBuilder::FinishPartition(uint64_t key_end, std::string* dst) {
+  if (!Availabe() || key_end <= partitioned_key_num_) {
+    return;
   }
+  const uint64_t key_num =
+      std::min<uint64_t>(key_end - partitioned_key_num_, hashes_.size());
+  policy_filter_->CreateFilter(hashes_.data(), key_num, dst);
+  // 生成分区之后hash就不再需要了，builder的内存只和分区大小相关
+  hashes_.erase(hashes_.begin(), hashes_.begin() + key_num);
+  block_hash_begin_ -= std::min<uint64_t>(block_hash_begin_, key_num);
+  partitioned_key_num_ += key_num;
 }
 }  // namespace corekv
@@ -16,7 +16,7 @@ class DataBlockBuilder final {
   //当前datablock的大小（加上restart数据）
   const uint64_t CurrentSize() {
     return buffer_.size() + restarts_.size() * sizeof(uint32_t) +
-           sizeof(uint32_t);
+           sizeof(uint32_t) + HashIndexSize();
   }
   //返回当前数据string
   const std::string& Data() { return buffer_; }
@@ -28,10 +28,15 @@ class DataBlockBuilder final {
       buffer_.clear();
       pre_key_ = "";
       restart_pointer_counter_ = 0;
+      hash_entries_.clear();
   }
   private:
   //添加restar
   void AddRestartPointers();
+  // 是否需要构建hash索引
+  bool UseHashIndex() const;
+  uint32_t HashBucketNum() const;
+  uint64_t HashIndexSize() const;
  private:
   
   bool is_finished_ = false;              // 判断本block是否结束了
@@ -40,22 +45,50 @@ class DataBlockBuilder final {
   std::vector<uint32_t> restarts_;        // 记录片的偏移
   uint32_t restart_pointer_counter_ = 0;  // 记录当前片数据条数，满16条就分片
   std::string pre_key_;                   // 记录前一个key(需要进行深度复制，不能使用string_view)
+  // hash索引的数据：key的hash和在block中的位置((restart下标 << 8) | entry下标)
+  std::vector<std::pair<uint32_t, uint16_t>> hash_entries_;
 };
 // filter_block_builder的话
 class FilterBlockBuilder final {
  public:
   FilterBlockBuilder(const Options& options);
   bool Availabe() { return policy_filter_ != nullptr; }
+  // 只记录key的64位hash，连续相同的hash只保留一个
   void Add(const std::string_view& key);
-  void CreateFilter();
   bool MayMatch(const std::string_view& key);
   bool MayMatch(const std::string_view& key,
                 const std::string_view& bf_datas);
   const std::string& Data();
-  void Finish(); 
+  // 生成filter block：[filter 0]...[filter n-1][各filter偏移][偏移数组位置][base_lg]
+  // 第i个filter覆盖偏移在[i*2^base_lg, (i+1)*2^base_lg)之间的data block
+  void Finish();
+  // data block落盘之后调用，前key_end个key中还没有归属的key属于这个block
+  // 每个偏移区间的filter在下一个区间开始时就生成，不需要缓存整个sst的key
+  void AddBlock(uint64_t block_offset, uint64_t key_end);
+  // 已经添加的key总数(包括已经生成了过滤器分区的)
+  uint64_t KeyNum() const { return partitioned_key_num_ + hashes_.size(); }
+  // 当前data block的key添加完成，返回KeyNum()；之后的key属于下一个block，
+  // 不会和之前的hash去重
+  uint64_t FinishBlock();
+  // 用前key_end个key中还没有生成过滤器的部分生成一个分区，追加到dst中
+  void FinishPartition(uint64_t key_end, std::string* dst);
+ private:
+  void GenerateFilter();
+
  private:
- std::string buffer_;
-  std::vector<std::string> datas_;
+  std::string buffer_;
+  // 还没有生成过滤器的key的hash，每个key只占8字节
+  std::vector<uint64_t> hashes_;
+  // hashes_中这个位置之前的hash属于已经结束的block
+  uint64_t block_hash_begin_ = 0;
+  // 已经生成了过滤器分区的key数
+  uint64_t partitioned_key_num_ = 0;
+  // 每个filter覆盖2^base_lg_字节的data block
+  uint32_t base_lg_;
+  // 已经落盘的block中最后一个key的序号
+  uint64_t block_key_end_ = 0;
+  // 每个filter在buffer_中的起始位置
+  std::vector<uint32_t> filter_offsets_;
   FilterPolicy* policy_filter_ = nullptr;
 };
 }  // namespace corekv
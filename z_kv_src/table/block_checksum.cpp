@@ -0,0 +1,23 @@
+#include "block_checksum.h"
+
+#include "../utils/crc32.h"
+#include "../utils/hash_util.h"
+namespace z_kv {
+uint32_t BlockChecksum(ChecksumType type, const char* data, size_t n,
+                       char compress_type) {
+  switch (type) {
+    case kCRC32cChecksum: {
+      uint32_t crc = crc32::Value(data, n);
+      crc = crc32::Extend(crc, &compress_type, 1);
+      return crc32::Mask(crc);
+    }
+    case kHash64Checksum:
+      // 压缩类型作为seed，写入时不需要把它和数据拼接到一起
+      return static_cast<uint32_t>(hash_util::Hash64(
+          data, n, static_cast<uint8_t>(compress_type)));
+    case kNoChecksum:
+    default:
+      return 0;
+  }
+}
+}  // namespace corekv
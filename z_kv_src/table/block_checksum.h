@@ -0,0 +1,11 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../db/options.h"
+namespace z_kv {
+// 计算block trailer中保存的校验值，覆盖block数据和1字节的压缩类型
+// crc32c保存的是Mask之后的值，和旧版本的sst兼容
+uint32_t BlockChecksum(ChecksumType type, const char* data, size_t n,
+                       char compress_type);
+}  // namespace corekv
@@ -2,29 +2,57 @@
 
 #include "../db/comparator.h"
 #include "../utils/codec.h"
+#include "../utils/hash_util.h"
+#include "table_options.h"
 namespace z_kv {
 using namespace util;
-// 反解析出来的实际restarts offset个数
-uint32_t DataBlock::NumRestarts() const {
-  return util::DecodeFixed32(data_ + size_ - sizeof(uint32_t));
-}
 DataBlock::~DataBlock() {}
 DataBlock::DataBlock(const std::string_view& contents)
-    : data_(contents.data()), size_(contents.size()), owned_(false) {
+    : data_(contents.data()),
+      size_(contents.size()),
+      contents_size_(contents.size()),
+      owned_(false) {
+  Init();
+}
+DataBlock::DataBlock(std::string&& contents)
+    : owned_(true), buffer_(std::move(contents)) {
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+  contents_size_ = size_;
+  Init();
+}
+void DataBlock::Init() {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
-  } else {
-    // 最后一个保存的是restart总个数，因此最多保留的restart个数(剩余所有的都是restarts
-    // offset)
-    size_t max_restarts_allowed = (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
-    // restart个数
-    uint32_t num_restart_size = NumRestarts();
-    if (num_restart_size > max_restarts_allowed) {
+    return;
+  }
+  // 最后保存的是restart总个数，最高位表示是否带有hash索引
+  uint32_t packed_num_restarts = DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  size_t restarts_end = size_ - sizeof(uint32_t);
+  if (packed_num_restarts & kDataBlockHashIndexFlag) {
+    if (restarts_end < sizeof(uint32_t)) {
       size_ = 0;
-    } else {
-      // 重启点开始的位置，也是数据部分的总长度
-      restart_offset_ = size_ - (1 + num_restart_size) * sizeof(uint32_t);
+      return;
+    }
+    num_buckets_ = DecodeFixed32(data_ + restarts_end - sizeof(uint32_t));
+    restarts_end -= sizeof(uint32_t);
+    if (num_buckets_ == 0 || num_buckets_ > restarts_end / sizeof(uint16_t)) {
+      size_ = 0;
+      return;
     }
+    restarts_end -= num_buckets_ * sizeof(uint16_t);
+    hash_buckets_ = data_ + restarts_end;
+  }
+  hash64_ = (packed_num_restarts & kDataBlockHash64Flag) != 0;
+  num_restarts_ =
+      packed_num_restarts & ~(kDataBlockHashIndexFlag | kDataBlockHash64Flag);
+  // 剩余所有的都是restarts offset，因此最多保留的restart个数
+  size_t max_restarts_allowed = restarts_end / sizeof(uint32_t);
+  if (num_restarts_ > max_restarts_allowed) {
+    size_ = 0;
+  } else {
+    // 重启点开始的位置，也是数据部分的总长度
+    restart_offset_ = restarts_end - num_restarts_ * sizeof(uint32_t);
   }
 }
 
@@ -62,13 +90,20 @@ class DataBlock::Iter : public Iterator {
   uint32_t const num_restarts_;  // Number of uint32_t entries in restart array
   uint32_t current_;
   uint32_t restart_index_;  // Index of restart block in which current_ falls
-  std::string key_;
-  std::string value_;
+  // key_没有共享前缀时直接指向block，否则指向key_buf_中重建的key
+  std::string_view key_;
+  std::string key_buf_;
+  // value_始终指向block中的数据
+  std::string_view value_;
   uint32_t offset_ = 0;
   DBStatus status_;
+  // hash索引
+  const char* const hash_buckets_;
+  uint32_t const num_buckets_;
+  bool const hash64_;
 
   inline int Compare(const std::string_view& a, const std::string_view& b) {
-    return comparator_->Compare(a.data(), b.data());
+    return comparator_->Compare(a, b);
   }
 
   // Return the offset in data_ just past the end of the current entry.
@@ -85,25 +120,29 @@ class DataBlock::Iter : public Iterator {
   }
 
   void SeekToRestartPoint(uint32_t index) {
-    key_.clear();
+    key_ = std::string_view();
     // 起始点开始位置
     restart_index_ = index;
     // current_ will be fixed by ParseNextKey();
 
     // 重启点的位置
     offset_ = GetRestartPoint(index);
-    value_ = std::string(data_ + offset_, 0);
+    value_ = std::string_view(data_ + offset_, 0);
   }
 
  public:
   Iter(std::shared_ptr<Comparator> comparator, const char* data,
-       uint32_t restarts, uint32_t num_restarts)
+       uint32_t restarts, uint32_t num_restarts, const char* hash_buckets,
+       uint32_t num_buckets, bool hash64)
       : comparator_(comparator),
         data_(data),
         restarts_(restarts),
         num_restarts_(num_restarts),
         current_(restarts_),
-        restart_index_(num_restarts_) {
+        restart_index_(num_restarts_),
+        hash_buckets_(hash_buckets),
+        num_buckets_(num_buckets),
+        hash64_(hash64) {
     assert(num_restarts_ > 0);
   }
   ~Iter() {}
@@ -113,7 +152,7 @@ class DataBlock::Iter : public Iterator {
     assert(Valid());
     return key_;
   }
-  std::string value() override {
+  std::string_view value() const override {
     assert(Valid());
     return value_;
   }
@@ -193,6 +232,50 @@ class DataBlock::Iter : public Iterator {
     }
   }
 
+  // 点查：通过hash索引直接定位，key一定不在block中时返回false
+  bool SeekForGet(const std::string_view& target) override {
+    if (hash_buckets_ == nullptr) {
+      Seek(target);
+      return true;
+    }
+    const uint32_t hash =
+        hash64_ ? static_cast<uint32_t>(
+                      hash_util::Hash64(target.data(), target.size()))
+                : hash_util::SimMurMurHash(target.data(), target.size());
+    const char* bucket_ptr =
+        hash_buckets_ + (hash % num_buckets_) * sizeof(uint16_t);
+    const uint16_t bucket =
+        static_cast<uint8_t>(bucket_ptr[0]) |
+        (static_cast<uint16_t>(static_cast<uint8_t>(bucket_ptr[1])) << 8);
+    if (bucket == kHashBucketEmpty) {
+      MarkInvalid();
+      return false;
+    }
+    if (bucket == kHashBucketCollision) {
+      Seek(target);
+      return true;
+    }
+    const uint32_t restart_index = bucket >> 8;
+    const uint32_t entry_index = bucket & 0xff;
+    if (restart_index >= num_restarts_) {
+      CorruptionError();
+      return false;
+    }
+    // 从restart开始解析到目标entry，中间不需要比较key
+    SeekToRestartPoint(restart_index);
+    for (uint32_t i = 0; i <= entry_index; ++i) {
+      if (!ParseNextKey()) {
+        return false;
+      }
+    }
+    // bucket中不是目标key，说明目标key不存在(否则会标记为冲突)
+    if (key_ != target) {
+      MarkInvalid();
+      return false;
+    }
+    return true;
+  }
+
   void SeekToFirst() override {
     SeekToRestartPoint(0);
     ParseNextKey();
@@ -206,12 +289,16 @@ class DataBlock::Iter : public Iterator {
   }
 
  private:
+  void MarkInvalid() {
+    current_ = restarts_;
+    restart_index_ = num_restarts_;
+  }
   void CorruptionError() {
     current_ = restarts_;
     restart_index_ = num_restarts_;
     status_ = Status::kInterupt;
-    key_.clear();
-    value_.clear();
+    key_ = std::string_view();
+    value_ = std::string_view();
   }
 
   bool ParseNextKey() {
@@ -235,9 +322,20 @@ class DataBlock::Iter : public Iterator {
       CorruptionError();
       return false;
     } else {
-      key_.resize(shared);
-      key_.append(p, non_shared);
-      value_ = std::string(p + non_shared, value_length);
+      if (shared == 0) {
+        // 没有共享前缀，key直接指向block，不需要复制
+        key_ = std::string_view(p, non_shared);
+      } else {
+        // 需要拼接前一个key的前缀，复用key_buf_的内存
+        if (key_.data() != key_buf_.data()) {
+          key_buf_.assign(key_.data(), shared);
+        } else {
+          key_buf_.resize(shared);
+        }
+        key_buf_.append(p, non_shared);
+        key_ = key_buf_;
+      }
+      value_ = std::string_view(p + non_shared, value_length);
       offset_ = (p - data_) + non_shared + value_length;
       // 更新restart_index_指针，到当前value所在的重启点数据的前一个
       while (restart_index_ + 1 < num_restarts_ &&
@@ -253,12 +351,13 @@ Iterator* DataBlock::NewIterator(std::shared_ptr<Comparator> comparator) {
   if (size_ < sizeof(uint32_t)) {
     return NewErrorIterator(Status::kInterupt);
   }
-  const auto num_restarts = NumRestarts();
+  const auto num_restarts = num_restarts_;
   if (num_restarts == 0) {
     return NewEmptyIterator();
   } else {
     // restart_offset_：重启点开始的位置，也是数据部分的总长度
-    return new Iter(comparator, data_, restart_offset_, num_restarts);
+    return new Iter(comparator, data_, restart_offset_, num_restarts,
+                    hash_buckets_, num_buckets_, hash64_);
   }
 }
 }  // namespace corekv
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <string>
 #include <string_view>
 #include <memory>
 #include "../db/iterator.h"
@@ -9,21 +10,35 @@ class DataBlock {
  public:
   // Initialize the block with the specified contents.
   explicit DataBlock(const std::string_view& contents);
+  // block持有数据(例如从文件读出或解压后的数据)，生命周期和block一致
+  explicit DataBlock(std::string&& contents);
 
   DataBlock(const DataBlock&) = delete;
   DataBlock& operator=(const DataBlock&) = delete;
   ~DataBlock();
   size_t size() const { return size_; }
+  // 未经解析的原始数据，filter分区这类不是kv格式的block通过它读取
+  std::string_view Contents() const {
+    return std::string_view(data_, contents_size_);
+  }
   Iterator* NewIterator(std::shared_ptr<Comparator> comparator);
 
  private:
   class Iter;
-  uint32_t NumRestarts() const;
+  void Init();
 
   const char* data_;
   size_t size_;
+  size_t contents_size_;
   uint32_t restart_offset_;  // Offset in data_ of restart array
+  uint32_t num_restarts_ = 0;
+  // hash索引，没有时为nullptr
+  const char* hash_buckets_ = nullptr;
+  uint32_t num_buckets_ = 0;
+  // hash索引使用Hash64，否则是旧版本的SimMurMurHash
+  bool hash64_ = false;
   bool owned_;               // Block owns data_[]
+  std::string buffer_;       // owned_为true时保存数据
 };
 
 }  // namespace corekv
\ No newline at end of file
@@ -9,24 +9,42 @@ void Footer::EncodeTo(std::string* dst) {
   offset_builder_.Encode(filter_block_, *dst);
   //16
   offset_builder_.Encode(index_block_, *dst);
+  // 校验算法和保留字段
+  PutFixed32(dst, static_cast<uint32_t>(checksum_type_));
+  PutFixed32(dst, 0);
   // 生成magic num
-  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber & 0xffffffffu));
-  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber >> 32));
+  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumberV2 & 0xffffffffu));
+  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumberV2 >> 32));
 }
 
 DBStatus Footer::DecodeFrom(std::string_view* input) {
-  const char* magic_ptr = input->data() + kEncodedLength - 8;
+  if (input->size() < kLegacyEncodedLength) {
+    return Status::kBadBlock;
+  }
+  const char* magic_ptr = input->data() + input->size() - 8;
   const uint32_t magic_lo = DecodeFixed32(magic_ptr);
   const uint32_t magic_hi = DecodeFixed32(magic_ptr + 4);
   const uint64_t magic = ((static_cast<uint64_t>(magic_hi) << 32) |
                           (static_cast<uint64_t>(magic_lo)));
-  if (magic != kTableMagicNumber) {
+  const char* footer_ptr = nullptr;
+  if (magic == kTableMagicNumber) {
+    footer_ptr = magic_ptr + 8 - kLegacyEncodedLength;
+    checksum_type_ = kCRC32cChecksum;
+  } else if (magic == kTableMagicNumberV2 &&
+             input->size() >= kEncodedLength) {
+    footer_ptr = magic_ptr + 8 - kEncodedLength;
+    const uint32_t checksum_type = DecodeFixed32(footer_ptr + 32);
+    if (checksum_type > kHash64Checksum) {
+      return Status::kBadBlock;
+    }
+    checksum_type_ = static_cast<ChecksumType>(checksum_type);
+  } else {
     return Status::kBadBlock;
   }
 
-  DBStatus result = offset_builder_.Decode(input->data(), filter_block_);
+  DBStatus result = offset_builder_.Decode(footer_ptr, filter_block_);
   if (result == Status::kSuccess) {
-    result = offset_builder_.Decode(input->data()+16, index_block_);
+    result = offset_builder_.Decode(footer_ptr + 16, index_block_);
   }
   if (result == Status::kSuccess) {
     // We skip over any leftover data (just padding for now) in "input"
@@ -41,6 +59,7 @@ std::string Footer::DebugString() {
          std::to_string(filter_block_.offset) +
          ", size = " + std::to_string(filter_block_.length) + " ], " +
          "[index_block_meta: offset = " + std::to_string(index_block_.offset) +
-         ", size = " + std::to_string(index_block_.length) + " ]";
+         ", size = " + std::to_string(index_block_.length) + " ], " +
+         "[checksum_type: " + std::to_string(checksum_type_) + " ]";
 }
 }  // namespace corekv
@@ -1,10 +1,14 @@
 #pragma once
+#include "../db/options.h"
 #include "offset_size.h"
 namespace z_kv {
 // 文件最后的block位置索引，可以理解为元数据
+// 写入的都是带校验算法的48字节footer，读取时兼容旧的40字节footer
 class Footer final {
  public:
   void EncodeTo(std::string* dst);
+  // input为文件末尾的数据(至少kLegacyEncodedLength字节)，根据末尾的magic
+  // 判断footer的版本
   DBStatus DecodeFrom(std::string_view* input);
   void SetFilterBlockMetaData(const OffSetSize& filter_block) {
     filter_block_ = filter_block;
@@ -14,6 +18,10 @@ class Footer final {
   }
   const OffSetSize& GetFilterBlockMetaData() const { return filter_block_; }
   const OffSetSize& GetIndexBlockMetaData() const { return index_block_; }
+  void SetChecksumType(ChecksumType checksum_type) {
+    checksum_type_ = checksum_type;
+  }
+  ChecksumType GetChecksumType() const { return checksum_type_; }
 
   std::string DebugString();
 
@@ -22,6 +30,8 @@ class Footer final {
   OffSetSize filter_block_;
   // index block部分在整个data block中的偏移量和大小
   OffSetSize index_block_;
+  // block trailer中的校验算法
+  ChecksumType checksum_type_ = kCRC32cChecksum;
   OffsetBuilder offset_builder_;
 };
 }  // namespace corekv
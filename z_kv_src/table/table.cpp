@@ -1,24 +1,294 @@
 #include "table.h"
+#include <map>
 #include <memory>
 #include "../db/comparator.h"
 #include "../logger/log.h"
 #include "../utils/codec.h"
-#include "../utils/crc32.h"
+#include "../utils/lz_compress.h"
+#include "block_checksum.h"
 #include "data_block.h"
 #include "footer.h"
 #include "table_options.h"
+#include "two_level_iterator.h"
 #include "../cache/cache.h"
+#include "../filter/filter_policy.h"
+#include "../utils/thread_pool.h"
 namespace z_kv {
 using namespace util;
-Table::Table(const Options* options, const FileReader* file_reader)
-    : options_(options), file_reader_(file_reader) {}
+Table::Table(const Options* options, const FileReader* file_reader,
+             uint64_t table_id)
+    : options_(options), file_reader_(file_reader), table_id_(table_id) {}
 DBStatus Table::Open(uint64_t file_size) {
-  if (file_size < kEncodedLength) {
+  if (file_size < kLegacyEncodedLength) {
     return Status::kInterupt;
   }
+  file_size_ = file_size;
+  return Status::kSuccess;
+}
+DBStatus Table::WarmUp() {
+  std::call_once(load_meta_once_,
+                 [this]() { load_meta_status_ = LoadMeta(); });
+  return load_meta_status_;
+}
+void Table::ScheduleWarmUp(ThreadPool* thread_pool) {
+  if (!thread_pool) {
+    WarmUp();
+    return;
+  }
+  thread_pool->Schedule([this]() { WarmUp(); });
+}
+bool Table::KeyMayMatch(const std::string_view& key) {
+  // 元数据加载失败时不能过滤，交给后面的读流程处理
+  if (WarmUp() != Status::kSuccess || !filter_policy_) {
+    return true;
+  }
+  if (filter_index_block_) {
+    return PartitionMayMatch(key);
+  }
+  if (bf_.empty()) {
+    return true;
+  }
+  if (!block_filter_) {
+    return filter_policy_->MayMatch(key, bf_);
+  }
+  // 先通过index找到key可能所在的block
+  std::unique_ptr<Iterator> index_iter(
+      index_block_->NewIterator(options_->comparator));
+  index_iter->Seek(key);
+  if (!index_iter->Valid()) {
+    return false;
+  }
+  OffSetSize offset_size;
+  OffsetBuilder offset_builder;
+  offset_builder.Decode(index_iter->value().data(), offset_size);
+  return BlockFilterMayMatch(offset_size.offset, key);
+}
+bool Table::FilterMayMatch(uint64_t block_offset,
+                           const std::string_view& key) {
+  if (!filter_policy_) {
+    return true;
+  }
+  if (filter_index_block_) {
+    return PartitionMayMatch(key);
+  }
+  if (bf_.empty()) {
+    return true;
+  }
+  if (!block_filter_) {
+    return filter_policy_->MayMatch(key, bf_);
+  }
+  return BlockFilterMayMatch(block_offset, key);
+}
+// filter block的格式见FilterBlockBuilder::Finish，数据异常时不过滤
+bool Table::BlockFilterMayMatch(uint64_t block_offset,
+                                const std::string_view& key) {
+  const size_t size = bf_.size();
+  if (size < sizeof(uint32_t) + 1) {
+    return true;
+  }
+  const char* data = bf_.data();
+  const uint32_t base_lg = static_cast<uint8_t>(data[size - 1]);
+  const uint32_t array_offset = DecodeFixed32(data + size - 5);
+  if (array_offset > size - 5 || base_lg > 31) {
+    return true;
+  }
+  const uint64_t filter_num = (size - 5 - array_offset) / sizeof(uint32_t);
+  const uint64_t index = block_offset >> base_lg;
+  if (index >= filter_num) {
+    return true;
+  }
+  const char* offset_array = data + array_offset;
+  const uint32_t start = DecodeFixed32(offset_array + index * sizeof(uint32_t));
+  const uint32_t limit =
+      index + 1 < filter_num
+          ? DecodeFixed32(offset_array + (index + 1) * sizeof(uint32_t))
+          : array_offset;
+  if (start > limit || limit > array_offset) {
+    return true;
+  }
+  if (start == limit) {
+    // 这个偏移区间内没有block，key一定不存在
+    return false;
+  }
+  return filter_policy_->MayMatch(
+      key, std::string_view(data + start, limit - start));
+}
+Iterator* Table::NewIndexIterator(const ReadOptions& options) {
+  Iterator* index_iter = index_block_->NewIterator(options_->comparator);
+  if (index_partitioned_) {
+    // index分区和data block的读取方式一样，都经过block cache
+    index_iter = NewTwoLevelIterator(
+        index_iter, [this, options](const std::string_view& index_value) {
+          return BlockReader(options, index_value);
+        });
+  }
+  return index_iter;
+}
+DBStatus Table::Get(const ReadOptions& options, const std::string_view& key,
+                    std::string* value) {
+  DBStatus s = WarmUp();
+  if (s != Status::kSuccess) {
+    return s;
+  }
+  std::unique_ptr<Iterator> index_iter(NewIndexIterator(options));
+  index_iter->Seek(key);
+  if (!index_iter->Valid()) {
+    s = index_iter->status();
+    return s == Status::kSuccess ? Status::kNotFound : s;
+  }
+  OffSetSize offset_size;
+  OffsetBuilder offset_builder;
+  offset_builder.Decode(index_iter->value().data(), offset_size);
+  if (!FilterMayMatch(offset_size.offset, key)) {
+    return Status::kNotFound;
+  }
+  std::unique_ptr<Iterator> block_iter(BlockReader(options, index_iter->value()));
+  if (block_iter->SeekForGet(key) && block_iter->Valid() &&
+      block_iter->key() == key) {
+    value->assign(block_iter->value().data(), block_iter->value().size());
+    return Status::kSuccess;
+  }
+  s = block_iter->status();
+  return s == Status::kSuccess ? Status::kNotFound : s;
+}
+void Table::MultiGet(const ReadOptions& options,
+                     const std::vector<std::string_view>& keys,
+                     std::vector<std::string>* values,
+                     std::vector<DBStatus>* statuses) {
+  values->assign(keys.size(), std::string());
+  statuses->assign(keys.size(), Status::kNotFound);
+  DBStatus s = WarmUp();
+  if (s != Status::kSuccess) {
+    statuses->assign(keys.size(), s);
+    return;
+  }
+  // 每个key所在的block，相同的block只读取一次
+  struct BlockSlot {
+    OffSetSize offset_size;
+    std::string buf;
+    DataBlock* block = nullptr;
+    CacheNode<uint64_t, DataBlock>* cache_handle = nullptr;
+    DBStatus status;
+  };
+  std::map<uint64_t, BlockSlot> slots;
+  std::vector<BlockSlot*> key_slots(keys.size(), nullptr);
+  std::unique_ptr<Iterator> index_iter(NewIndexIterator(options));
+  OffsetBuilder offset_builder;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    index_iter->Seek(keys[i]);
+    if (!index_iter->Valid()) {
+      if (index_iter->status() != Status::kSuccess) {
+        (*statuses)[i] = index_iter->status();
+      }
+      continue;
+    }
+    OffSetSize offset_size;
+    offset_builder.Decode(index_iter->value().data(), offset_size);
+    if (!FilterMayMatch(offset_size.offset, keys[i])) {
+      continue;
+    }
+    BlockSlot& slot = slots[offset_size.offset];
+    slot.offset_size = offset_size;
+    key_slots[i] = &slot;
+  }
+  // cache中没有的block一次性提交批量读取，mmap模式下直接读取映射
+  std::vector<ReadRequest> requests;
+  std::vector<BlockSlot*> request_slots;
+  for (auto& [offset, slot] : slots) {
+    if (options_->block_cache != nullptr) {
+      slot.cache_handle =
+          options_->block_cache->Get(BlockCacheId(slot.offset_size));
+      if (slot.cache_handle != nullptr) {
+        slot.block = slot.cache_handle->value;
+        continue;
+      }
+    }
+    if (file_reader_->IsMmap()) {
+      slot.status =
+          LoadBlock(slot.offset_size, &slot.block, &slot.cache_handle);
+      continue;
+    }
+    ReadRequest request;
+    request.reader = file_reader_;
+    request.offset = slot.offset_size.offset;
+    request.len = slot.offset_size.length + kBlockTrailerSize;
+    request.result = &slot.buf;
+    requests.push_back(request);
+    request_slots.push_back(&slot);
+  }
+  FileReader::MultiRead(requests.data(), requests.size());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    BlockSlot* slot = request_slots[i];
+    slot->status = requests[i].status;
+    if (slot->status != Status::kSuccess) {
+      continue;
+    }
+    std::string_view contents;
+    slot->status =
+        DecodeBlock(slot->offset_size, slot->buf, &contents, &slot->buf);
+    if (slot->status == Status::kSuccess) {
+      slot->status = NewBlock(slot->offset_size, contents, std::move(slot->buf),
+                              &slot->block, &slot->cache_handle);
+    }
+  }
+  for (size_t i = 0; i < keys.size(); ++i) {
+    BlockSlot* slot = key_slots[i];
+    if (slot == nullptr) {
+      continue;
+    }
+    if (slot->block == nullptr) {
+      (*statuses)[i] = slot->status;
+      continue;
+    }
+    std::unique_ptr<Iterator> block_iter(
+        slot->block->NewIterator(options_->comparator));
+    if (block_iter->SeekForGet(keys[i]) && block_iter->Valid() &&
+        block_iter->key() == keys[i]) {
+      (*values)[i].assign(block_iter->value().data(),
+                          block_iter->value().size());
+      (*statuses)[i] = Status::kSuccess;
+    } else if (block_iter->status() != Status::kSuccess) {
+      (*statuses)[i] = block_iter->status();
+    }
+  }
+  for (auto& [offset, slot] : slots) {
+    if (slot.block != nullptr) {
+      ReleaseBlock(slot.block, slot.cache_handle);
+    }
+  }
+}
+// 在顶层索引中找到key所在的filter分区，只加载这一个分区
+bool Table::PartitionMayMatch(const std::string_view& key) {
+  std::unique_ptr<Iterator> iter(
+      filter_index_block_->NewIterator(options_->comparator));
+  iter->Seek(key);
+  if (!iter->Valid()) {
+    // key比sst中所有的key都大
+    return false;
+  }
+  OffSetSize offset_size;
+  OffsetBuilder offset_builder;
+  offset_builder.Decode(iter->value().data(), offset_size);
+  DataBlock* block = nullptr;
+  CacheNode<uint64_t, DataBlock>* cache_handle = nullptr;
+  if (LoadBlock(offset_size, &block, &cache_handle) != Status::kSuccess) {
+    return true;
+  }
+  bool may_match = filter_policy_->MayMatch(key, block->Contents());
+  ReleaseBlock(block, cache_handle);
+  return may_match;
+}
+// 读取footer、index block和filter
+DBStatus Table::LoadMeta() {
+  if (file_size_ < kLegacyEncodedLength) {
+    return Status::kInterupt;
+  }
+  // 新旧footer长度不同，按新的长度读取，由DecodeFrom根据magic判断版本
+  const uint64_t footer_size =
+      file_size_ < kEncodedLength ? kLegacyEncodedLength : kEncodedLength;
   std::string footer_space;
-  footer_space.resize(kEncodedLength);
-  auto status = file_reader_->Read(file_size - kEncodedLength, kEncodedLength,
+  footer_space.resize(footer_size);
+  auto status = file_reader_->Read(file_size_ - footer_size, footer_size,
                                    &footer_space);
   if (status != Status::kSuccess) {
     return status;
@@ -26,60 +296,172 @@ DBStatus Table::Open(uint64_t file_size) {
   Footer footer;
   std::string_view st = footer_space;
   status = footer.DecodeFrom(&st);
+  if (status != Status::kSuccess) {
+    return status;
+  }
+  checksum_type_ = footer.GetChecksumType();
   std::string index_meta_data;
-  ReadBlock(footer.GetIndexBlockMetaData(), index_meta_data);
-  index_block_ = std::make_unique<DataBlock>(index_meta_data);
+  status = ReadBlock(footer.GetIndexBlockMetaData(), index_meta_data);
+  if (status != Status::kSuccess) {
+    return status;
+  }
+  index_block_ = std::make_unique<DataBlock>(std::move(index_meta_data));
   ReadMeta(&footer);
   return status;
 }
 
+// 读取block并校验，buf中返回去掉trailer并解压之后的数据
 DBStatus Table::ReadBlock(const OffSetSize& offset_size, std::string& buf) {
-  buf.resize(offset_size.length + kBlockTrailerSize);
-  file_reader_->Read(offset_size.offset, offset_size.length + kBlockTrailerSize,
-                     &buf);
-  const char* data = buf.data();
-  const uint32_t crc =
-      crc32::Unmask(DecodeFixed32(data + offset_size.length + 1));
-  const uint32_t actual = crc32::Value(data, offset_size.length + 1);
-
-  if (crc != actual) {
+  std::string_view contents;
+  DBStatus status = ReadBlock(offset_size, &contents, &buf);
+  if (status == Status::kSuccess && contents.data() != buf.data()) {
+    buf.assign(contents.data(), contents.size());
+  }
+  return status;
+}
+// contents指向去掉trailer并解压之后的数据：mmap模式下未压缩的block直接
+// 指向映射中的数据，否则保存在buf中
+DBStatus Table::ReadBlock(const OffSetSize& offset_size,
+                          std::string_view* contents, std::string* buf) {
+  std::string_view block;
+  auto status = file_reader_->Read(
+      offset_size.offset, offset_size.length + kBlockTrailerSize, &block, buf);
+  if (status != Status::kSuccess) {
+    return status;
+  }
+  return DecodeBlock(offset_size, block, contents, buf);
+}
+// 校验读到的block(带trailer)并解压，block可以指向buf
+DBStatus Table::DecodeBlock(const OffSetSize& offset_size,
+                            const std::string_view& block,
+                            std::string_view* contents, std::string* buf) {
+  if (block.size() != offset_size.length + kBlockTrailerSize) {
+    return Status::kBadBlock;
+  }
+  const char* data = block.data();
+  const uint32_t expected = DecodeFixed32(data + offset_size.length + 1);
+  const uint32_t actual = BlockChecksum(
+      checksum_type_, data, offset_size.length, data[offset_size.length]);
+  if (checksum_type_ != kNoChecksum && expected != actual) {
     LOG(z_kv::LogLevel::ERROR, "Invalid Block");
     return Status::kInvalidObject;
   }
   switch (data[offset_size.length]) {
+    case kLZCompression:
+    case kLZDictCompression: {
+      std::string_view dict;
+      if (data[offset_size.length] == kLZDictCompression) {
+        // 字典在LoadMeta中加载，data block的读取都在这之后
+        if (compression_dict_.empty()) {
+          LOG(z_kv::LogLevel::ERROR, "Missing compression dict");
+          return Status::kBadBlock;
+        }
+        dict = compression_dict_;
+      }
+      std::string uncompressed;
+      if (!lz::Uncompress(dict, data, offset_size.length, &uncompressed)) {
+        LOG(z_kv::LogLevel::ERROR, "Uncompress block failed");
+        return Status::kBadBlock;
+      }
+      buf->swap(uncompressed);
+      *contents = *buf;
+    } break;
+    // 旧版本的sst中kSnappyCompression标记的block实际保存的是原始数据
     case kSnappyCompression:
-      LOG(z_kv::LogLevel::ERROR, "kSnappyCompression");
-      break;
     default:
-      LOG(z_kv::LogLevel::ERROR, "kNonCompress");
+      if (data == buf->data()) {
+        buf->resize(offset_size.length);
+        *contents = *buf;
+      } else {
+        *contents = block.substr(0, offset_size.length);
+      }
       break;
   }
   return Status::kSuccess;
 }
+// 读取meta block，加载布隆过滤器和压缩字典
 void Table::ReadMeta(const Footer* footer) {
-  if (options_->filter_policy == nullptr) {
+  const auto& meta_offset_size = footer->GetFilterBlockMetaData();
+  if (meta_offset_size.length == 0) {
     return;
   }
   std::string filter_meta_data;
-  ReadBlock(footer->GetFilterBlockMetaData(), filter_meta_data);
-  std::string_view real_data(filter_meta_data.data(),
-                             footer->GetFilterBlockMetaData().length);
-  std::unique_ptr<DataBlock> meta = std::make_unique<DataBlock>(real_data);
+  if (ReadBlock(meta_offset_size, filter_meta_data) != Status::kSuccess) {
+    return;
+  }
+  std::unique_ptr<DataBlock> meta =
+      std::make_unique<DataBlock>(std::move(filter_meta_data));
   Iterator* iter = meta->NewIterator(std::make_shared<ByteComparator>());
-  std::string_view key = options_->filter_policy->Name();
+  std::string_view key = kCompressionDictKey;
+  iter->Seek(key);
+  if (iter->Valid() && iter->key() == key) {
+    ReadCompressionDict(iter->value());
+  }
+  key = kIndexTypeKey;
   iter->Seek(key);
   if (iter->Valid() && iter->key() == key) {
-    LOG(z_kv::LogLevel::ERROR, "Hit Key=%s",key.data());
-    ReadFilter(iter->value());
+    index_partitioned_ = (iter->value() == kTwoLevelIndexType);
+  }
+  // 写入时的过滤器可能是按层选择的(Options::ForLevel)，和options_中的
+  // 不一定相同，按meta block中记录的过滤器名字创建查询用的policy
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    std::string_view name = iter->key();
+    const std::string_view block_prefix = kBlockFilterPrefix;
+    const std::string_view partitioned_prefix = kPartitionedFilterPrefix;
+    const bool block_filter =
+        name.substr(0, block_prefix.size()) == block_prefix;
+    const bool partitioned =
+        name.substr(0, partitioned_prefix.size()) == partitioned_prefix;
+    if (block_filter) {
+      name.remove_prefix(block_prefix.size());
+    } else if (partitioned) {
+      name.remove_prefix(partitioned_prefix.size());
+    }
+    std::shared_ptr<FilterPolicy> policy =
+        options_->filter_policy && name == options_->filter_policy->Name()
+            ? options_->filter_policy
+            : NewFilterPolicyByName(name);
+    if (!policy) {
+      continue;
+    }
+    if (partitioned) {
+      // 分区过滤器只加载顶层索引
+      OffSetSize offset_size;
+      OffsetBuilder offset_builder;
+      offset_builder.Decode(iter->value().data(), offset_size);
+      std::string filter_index;
+      if (ReadBlock(offset_size, filter_index) == Status::kSuccess) {
+        filter_index_block_ =
+            std::make_unique<DataBlock>(std::move(filter_index));
+        filter_policy_ = policy;
+      }
+    } else {
+      // 不带前缀的是旧版本的sst：整个sst一个布隆过滤器
+      block_filter_ = block_filter;
+      ReadFilter(iter->value());
+      if (!bf_.empty()) {
+        filter_policy_ = policy;
+      }
+    }
+    break;
   }
   delete iter;
 }
+void Table::ReadCompressionDict(const std::string_view& dict_handle_value) {
+  OffSetSize offset_size;
+  OffsetBuilder offset_builder;
+  offset_builder.Decode(dict_handle_value.data(), offset_size);
+  if (ReadBlock(offset_size, compression_dict_) != Status::kSuccess) {
+    compression_dict_.clear();
+  }
+}
 void Table::ReadFilter(const std::string_view& filter_handle_value) {
   OffSetSize offset_size;
   OffsetBuilder offset_builder;
   offset_builder.Decode(filter_handle_value.data(), offset_size);
-  ReadBlock(offset_size, bf_);
-  bf_.resize(offset_size.length);
+  if (ReadBlock(offset_size, bf_) != Status::kSuccess) {
+    bf_.clear();
+  }
 }
 static void DeleteCachedBlock(const uint64_t& key, void* value) {
   DataBlock* block = reinterpret_cast<DataBlock*>(value);
@@ -89,43 +471,81 @@ static void DeleteBlock(void* arg, void*) {
   delete reinterpret_cast<DataBlock*>(arg);
 }
 
-static void ReleaseBlock(void* arg, void* h) {
-  CacheNode<uint64_t, DataBlock>* node = reinterpret_cast<CacheNode<uint64_t, DataBlock>*>(arg);
+static void ReleaseCachedBlock(void* arg, void* h) {
   Cache<uint64_t, DataBlock>* cache = reinterpret_cast<Cache<uint64_t, DataBlock>*>(arg);
+  CacheNode<uint64_t, DataBlock>* node = reinterpret_cast<CacheNode<uint64_t, DataBlock>*>(h);
   cache->Release(node);
 }
 
+DBStatus Table::LoadBlock(const OffSetSize& offset_size, DataBlock** block,
+                          CacheNode<uint64_t, DataBlock>** cache_handle) {
+  auto* block_cache = options_->block_cache;
+  *block = nullptr;
+  *cache_handle = nullptr;
+  if (block_cache != nullptr) {
+    *cache_handle = block_cache->Get(BlockCacheId(offset_size));
+    if (*cache_handle != nullptr) {
+      *block = (*cache_handle)->value;
+      return Status::kSuccess;
+    }
+  }
+  std::string contents;
+  std::string_view view;
+  DBStatus s = ReadBlock(offset_size, &view, &contents);
+  if (s != Status::kSuccess) {
+    return s;
+  }
+  return NewBlock(offset_size, view, std::move(contents), block, cache_handle);
+}
+// 用读取到的数据创建block，数据在buf中时放入block cache
+DBStatus Table::NewBlock(const OffSetSize& offset_size,
+                         const std::string_view& contents, std::string&& buf,
+                         DataBlock** block,
+                         CacheNode<uint64_t, DataBlock>** cache_handle) {
+  auto* block_cache = options_->block_cache;
+  *cache_handle = nullptr;
+  if (contents.data() != buf.data()) {
+    // mmap中的数据本身就在页缓存中，不需要再放入block cache
+    *block = new DataBlock(contents);
+    return Status::kSuccess;
+  }
+  *block = new DataBlock(std::move(buf));
+  if (block_cache != nullptr) {
+    const uint64_t cache_id = BlockCacheId(offset_size);
+    block_cache->RegistCleanHandle(DeleteCachedBlock);
+    block_cache->Insert(cache_id, *block);
+    // block交给cache管理之后需要持有引用，防止使用过程中被淘汰释放
+    *cache_handle = block_cache->Get(cache_id);
+    if (*cache_handle == nullptr) {
+      *block = nullptr;
+      return Status::kNotFound;
+    }
+    *block = (*cache_handle)->value;
+  }
+  return Status::kSuccess;
+}
+void Table::ReleaseBlock(DataBlock* block,
+                         CacheNode<uint64_t, DataBlock>* cache_handle) {
+  if (cache_handle != nullptr) {
+    options_->block_cache->Release(cache_handle);
+  } else {
+    delete block;
+  }
+}
+
 Iterator* Table::BlockReader(const ReadOptions& options,
                              const std::string_view& index_value) {
-  auto* block_cache = options_->block_cache;
+  // data block可能依赖压缩字典，先保证元数据已经加载
+  DBStatus s = WarmUp();
+  if (s != Status::kSuccess) {
+    return NewErrorIterator(s);
+  }
   DataBlock* block = nullptr;
   CacheNode<uint64_t, DataBlock>* cache_handle = nullptr;
   OffSetSize offset_size;
   OffsetBuilder offset_builder;
   offset_builder.Decode(index_value.data(), offset_size);
-  DBStatus s;
-  std::string contents;
-  if (block_cache != nullptr) {
-    uint64_t cache_id = table_id_ * 10 + offset_size.offset;
-    cache_handle = block_cache->Get(cache_id);
-    if (cache_handle != nullptr) {
-      block = cache_handle->value;
-    } else {
-      s = ReadBlock(offset_size, contents);
-      if (s == Status::kSuccess) {
-        block = new DataBlock(contents);
-        {
-          block_cache->RegistCleanHandle(DeleteCachedBlock);
-          block_cache->Insert(cache_id, block);
-        }
-      }
-    }
-  } else {
-    s = ReadBlock(offset_size, contents);
-    if (s == Status::kSuccess) {
-      block = new DataBlock(contents);
-    }
-  }
+  s = LoadBlock(offset_size, &block, &cache_handle);
 
   Iterator* iter;
   if (block != nullptr) {
@@ -133,11 +553,23 @@ Iterator* Table::BlockReader(const ReadOptions& options,
     if (cache_handle == nullptr) {
       iter->RegisterCleanup(&DeleteBlock, block, nullptr);
     } else {
-      iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
+      iter->RegisterCleanup(&ReleaseCachedBlock, options_->block_cache,
+                            cache_handle);
     }
   } else {
     iter = NewErrorIterator(s);
   }
   return iter;
 }
+Iterator* Table::NewIterator(const ReadOptions& options) {
+  DBStatus s = WarmUp();
+  if (s != Status::kSuccess) {
+    return NewErrorIterator(s);
+  }
+  return NewTwoLevelIterator(
+      NewIndexIterator(options),
+      [this, options](const std::string_view& index_value) {
+        return BlockReader(options, index_value);
+      });
+}
 }  // namespace corekv
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "../db/iterator.h"
 #include "../db/options.h"
@@ -9,23 +11,89 @@
 #include "offset_size.h"
 namespace z_kv {
 
+class ThreadPool;
+// sst的读取对象
+// Open只记录文件大小，footer、index block和filter的读取延迟到第一次使用时，
+// 这样打开大量sst时不需要任何io，也可以交给后台线程池提前预热
 class Table final {
  public:
-  Table(const Options* options, const FileReader* file_reader);
+  Table(const Options* options, const FileReader* file_reader,
+        uint64_t table_id = 0);
   DBStatus Open(uint64_t file_size);
+  // 加载sst的元数据(footer/index/filter)，多次调用只会加载一次
+  DBStatus WarmUp();
+  // 交给后台线程池预热，调用者需要保证预热完成前table不会被释放
+  void ScheduleWarmUp(ThreadPool* thread_pool);
+  // 根据布隆过滤器判断key是否可能存在
+  bool KeyMayMatch(const std::string_view& key);
+  // 点查：index定位block之后先查这个block对应的filter，再在block中查找
+  // key不存在时返回kNotFound
+  DBStatus Get(const ReadOptions& options, const std::string_view& key,
+               std::string* value);
+  // 批量点查：先通过index和filter确定每个key所在的block，block cache中没有的
+  // block通过FileReader::MultiRead一次提交，statuses中返回每个key的结果
+  void MultiGet(const ReadOptions& options,
+                const std::vector<std::string_view>& keys,
+                std::vector<std::string>* values,
+                std::vector<DBStatus>* statuses);
   DBStatus ReadBlock(const OffSetSize&, std::string&);
+  DBStatus ReadBlock(const OffSetSize& offset_size, std::string_view* contents,
+                     std::string* buf);
   void ReadMeta(const Footer* footer);
   void ReadFilter(const std::string_view& filter_handle_value);
-  Iterator* NewIterator(const ReadOptions&) const;
+  void ReadCompressionDict(const std::string_view& dict_handle_value);
+  // 遍历整个sst，分区索引时index本身也是一个两层迭代器
+  Iterator* NewIterator(const ReadOptions&);
  Iterator* BlockReader(const ReadOptions&,
                                const std::string_view&);
+  private:
+  DBStatus LoadMeta();
+  // 读取block，有block cache时优先从cache获取，
+  // 使用完之后需要调用ReleaseBlock
+  DBStatus LoadBlock(const OffSetSize& offset_size, DataBlock** block,
+                     CacheNode<uint64_t, DataBlock>** cache_handle);
+  DBStatus DecodeBlock(const OffSetSize& offset_size,
+                       const std::string_view& block,
+                       std::string_view* contents, std::string* buf);
+  DBStatus NewBlock(const OffSetSize& offset_size,
+                    const std::string_view& contents, std::string&& buf,
+                    DataBlock** block,
+                    CacheNode<uint64_t, DataBlock>** cache_handle);
+  // 高32位是sst_id，低32位是block在sst中的偏移
+  uint64_t BlockCacheId(const OffSetSize& offset_size) const {
+    return (table_id_ << 32) | offset_size.offset;
+  }
+  void ReleaseBlock(DataBlock* block,
+                    CacheNode<uint64_t, DataBlock>* cache_handle);
+  bool PartitionMayMatch(const std::string_view& key);
+  // 根据data block的偏移只查询对应的filter
+  bool FilterMayMatch(uint64_t block_offset, const std::string_view& key);
+  bool BlockFilterMayMatch(uint64_t block_offset, const std::string_view& key);
+  Iterator* NewIndexIterator(const ReadOptions& options);
+
   private:
   const Options* options_;
   const FileReader* file_reader_;
   uint64_t table_id_ = 0;
+  uint64_t file_size_ = 0;
+  // footer中记录的block校验算法
+  ChecksumType checksum_type_ = kCRC32cChecksum;
+  // 保证元数据只加载一次
+  std::once_flag load_meta_once_;
+  DBStatus load_meta_status_;
+  // sst中记录的过滤器，按名字创建，读取失败或者没有过滤器时为空
+  std::shared_ptr<FilterPolicy> filter_policy_;
   std::string bf_;
+  // bf_是按block偏移划分的filter block，否则是整个sst一个的布隆过滤器
+  bool block_filter_ = false;
+  // data block压缩使用的字典，整个sst共享
+  std::string compression_dict_;
   // index_block对象，用于两层迭代器使用
   std::unique_ptr<DataBlock> index_block_;
+  // index_block_是否是分区索引的顶层索引
+  bool index_partitioned_ = false;
+  // 分区过滤器的顶层索引，常驻内存，filter分区通过block cache按需加载
+  std::unique_ptr<DataBlock> filter_index_block_;
 
 };
 }  // namespace corekv
@@ -1,9 +1,14 @@
 #include "table_builder.h"
 
+#include <algorithm>
+#include <map>
+
 #include "../db/comparator.h"
 #include "../logger/log.h"
 #include "../utils/codec.h"
-#include "../utils/crc32.h"
+#include "../utils/lz_compress.h"
+#include "../utils/thread_pool.h"
+#include "block_checksum.h"
 #include "footer.h"
 #include "table_options.h"
 namespace z_kv {
@@ -14,10 +19,42 @@ TableBuilder::TableBuilder(const Options& options, FileWriter* file_handler)
       index_options_(options),
       data_block_builder_(&options_),
       index_block_builder_(&index_options_),
-      filter_block_builder_(options_) {
+      filter_block_builder_(options_),
+      top_index_block_builder_(&index_options_),
+      top_filter_block_builder_(&index_options_),
+      compress_cv_(&compress_mutex_) {
   //indexblock的分片大小为1（不分片，不压缩）
   index_options_.block_restart_interval = 1;
+  // index block中的key都是分隔key，不能用hash索引精确匹配
+  index_options_.data_block_hash_ratio = 0;
   file_handler_ = file_handler;
+  // 只有LZ压缩支持字典
+  train_compression_dict_ =
+      options_.compression_dict_size > 0 &&
+      (options_.block_compress_type == kLZCompression ||
+       options_.block_compress_type == kSnappyCompression);
+  if (options_.compress_pool) {
+    max_pending_blocks_ = std::max<uint32_t>(1, options_.compress_pending_blocks);
+  }
+}
+TableBuilder::TableBuilder(const Options& options, FileWriter* file_handler,
+                           int32_t level)
+    : TableBuilder(options.ForLevel(level), file_handler) {}
+std::unique_ptr<FileWriter> TableBuilder::NewFileWriter(
+    const Options& options, const std::string& file_name) {
+  FileWriterOptions writer_options;
+  writer_options.direct_io = options.use_direct_io_for_flush_and_compaction;
+  writer_options.buffer_num = options.table_write_buffer_num;
+  writer_options.bytes_per_sync = options.bytes_per_sync;
+  writer_options.preallocate_size = options.table_preallocate_size;
+  return std::make_unique<FileWriter>(file_name, writer_options);
+}
+TableBuilder::~TableBuilder() {
+  // 后台压缩任务引用了builder的成员，需要等它们全部结束
+  ScopedLockImpl<MutexLock> lock_guard(compress_mutex_);
+  while (running_compress_ > 0) {
+    compress_cv_.Wait();
+  }
 }
 //向sst文件中添加KV，缓冲区达到要求就调用落盘
 void TableBuilder::Add(const std::string_view& key,
@@ -30,18 +67,25 @@ void TableBuilder::Add(const std::string_view& key,
     //pre_block_last_key_传出为pre_block_last_key_,和key之间的最短串
     // index中key做了优化，尽可能短
     options_.comparator->FindShortest(pre_block_last_key_, key);
-    std::string output;
-    // index中的value保存的是当前key在block中的偏移量和对应的block大小
-    index_block_offset_size_builder_.Encode(pre_block_offset_size_, output);
-    index_block_builder_.Add(pre_block_last_key_, output);
+    if (!pending_blocks_.empty()) {
+      // 上一个block还在等待压缩或字典训练，偏移还不确定，先记录index的key
+      pending_blocks_.back()->index_key = pre_block_last_key_;
+    } else {
+      AddIndexEntry(pre_block_last_key_, pre_block_offset_size_,
+                    last_block_filter_key_end_);
+    }
     need_create_index_block_ = false;
   }
-  // 把key添加到布隆过滤器的buffer中，为最后构建布隆过滤器做准备(整个sst就构建一个)
+  // 把key的hash添加到过滤器的buffer中，所在的block落盘之后生成对应偏移区间的filter
   if (filter_block_builder_.Availabe()) {
     filter_block_builder_.Add(key);
   }
 
   pre_block_last_key_ = key;//用当前key覆盖前一个key
+  if (entry_count_ == 0) {
+    smallest_key_ = key;
+  }
+  largest_key_ = key;
   ++entry_count_;//数据计数加一
   // 写入data block
   data_block_builder_.Add(key, value);
@@ -52,27 +96,77 @@ void TableBuilder::Add(const std::string_view& key,
 }
 //将datablock落盘
 void TableBuilder::Flush() {
-  if (data_block_builder_.CurrentSize() == 0) {
+  if (data_block_builder_.Data().empty()) {
     return;
   }
-  //把分片信息追加到datablock的buffer，然后落盘，最后重置datablock
-  WriteDataBlock(data_block_builder_, pre_block_offset_size_);
-  // 如果写入数据成功
-  if (status_ == Status::kSuccess) {
-    //在下一轮循环中时，就需要更新我们的index block数据
-    need_create_index_block_ = true;
-    // 对于批量写缓冲区剩余的数据需要手动进行刷盘，至此一个block才能保证全部落盘
-    status_ = file_handler_->FlushBuffer();
+  // restart_pointer（分片信息）加在数据后面，block交给压缩流水线
+  data_block_builder_.Finish();
+  auto block = std::make_shared<PendingBlock>();
+  block->contents = data_block_builder_.Data();
+  block->filter_key_end = filter_block_builder_.FinishBlock();
+  data_block_builder_.Reset();
+  pending_blocks_.push_back(block);
+  //在下一轮循环中时，就需要更新我们的index block数据
+  need_create_index_block_ = true;
+  if (train_compression_dict_) {
+    // 字典还没有训练好，block先缓存下来作为样本
+    sample_bytes_ += block->contents.size();
+    if (sample_bytes_ >= options_.compression_dict_sample_size) {
+      FinishCompressionDict();
+    }
+    return;
+  }
+  SubmitBlock(block);
+  WriteCompletedBlocks(false);
+}
+// 压缩一个block，返回实际使用的压缩类型，output为空表示使用原始数据
+static BlockCompressType CompressBlock(const std::string& datas,
+                                       BlockCompressType block_compress_type,
+                                       const lz::Dictionary* compression_dict,
+                                       std::string* output) {
+  output->clear();
+  switch (block_compress_type) {
+    // 没有snappy库，统一使用内置的LZ压缩
+    case kSnappyCompression:
+    case kLZCompression:
+    case kLZDictCompression: {
+      const lz::Dictionary* dict = nullptr;
+      BlockCompressType type = kLZCompression;
+      if (block_compress_type == kLZDictCompression && compression_dict) {
+        dict = compression_dict;
+        type = kLZDictCompression;
+      }
+      lz::Compress(dict, datas.data(), datas.size(), output);
+      // 压缩率不到12.5%就直接保存原始数据，读取时省掉解压的开销
+      if (output->size() < datas.size() - (datas.size() / 8u)) {
+        return type;
+      }
+      output->clear();
+      return kNonCompress;
+    }
+    default:
+      return kNonCompress;
   }
 }
+// 生成block的trailer：一位的压缩类型+4位的校验值
+static void BuildBlockTrailer(const std::string& contents,
+                              BlockCompressType type,
+                              ChecksumType checksum_type, char* trailer) {
+  //写入压缩类型
+  trailer[0] = static_cast<uint8_t>(type);
+  //生成校验码(覆盖压缩类型)，定长编码
+  EncodeFixed32(trailer + 1, BlockChecksum(checksum_type, contents.data(),
+                                           contents.size(), trailer[0]));
+}
 //把分片信息追加到datablock的buffer，然后落盘，返回位置信息，最后重置datablock
 void TableBuilder::WriteDataBlock(DataBlockBuilder& data_block_builder,
+                                  BlockCompressType block_compress_type,
                                   OffSetSize& offset_size) {
   // restart_pointer（分片信息）加在数据后面
   data_block_builder.Finish();
   // 将所有的record数据打包
   const std::string& data = data_block_builder.Data();
-  WriteBytesBlock(data, options_.block_compress_type, offset_size);
+  WriteBytesBlock(data, block_compress_type, offset_size);
   // 这里直接调用reset操作，主要目的是比较方便，创建一个空对象直接替换也行
   data_block_builder.Reset();
 }
@@ -80,39 +174,166 @@ void TableBuilder::WriteDataBlock(DataBlockBuilder& data_block_builder,
 void TableBuilder::WriteBytesBlock(const std::string& datas,
                                    BlockCompressType block_compress_type,
                                    OffSetSize& offset_size) {
-  std::string compress_data = datas;
-  bool compress_success = false;
   //确定压缩类型
-  BlockCompressType type = block_compress_type;
-  switch (block_compress_type) {
-    case kSnappyCompression: {
-      compress_data = datas;
-      compress_success = true;
-    } break;
-    default:
-      type = kNonCompress;
-      break;
-  }
-
+  const BlockCompressType type = CompressBlock(
+      datas, block_compress_type, compression_dict_.get(), &compress_output_);
+  const std::string& block_contents =
+      compress_output_.empty() ? datas : compress_output_;
+  char trailer[kBlockTrailerSize];
+  BuildBlockTrailer(block_contents, type, options_.checksum_type, trailer);
+  AppendBlock(block_contents, trailer, offset_size);
+}
+//追加block数据和trailer
+void TableBuilder::AppendBlock(const std::string& block_contents,
+                               const char* trailer, OffSetSize& offset_size) {
   offset_size.offset = block_offset_;
-  offset_size.length = datas.size();
+  offset_size.length = block_contents.size();
   // 在sst中追加我们的block数据
-  status_ = file_handler_->Append(datas.data(), datas.size());
-  char trailer[kBlockTrailerSize];//一位的压缩类型+4位的循环校验
-  //写入压缩类型
-  trailer[0] = static_cast<uint8_t>(type);
-  //生成crc校验码
-  uint32_t crc = crc32::Value(datas.data(), datas.size());
-  crc = crc32::Extend(crc, trailer, 1);  // Extend crc to cover block type
-  //定长编码
-  EncodeFixed32(trailer + 1, crc32::Mask(crc));
+  status_ = file_handler_->Append(block_contents.data(), block_contents.size());
   //追加后缀数据
-  status_ = file_handler_->Append(trailer, kBlockTrailerSize);
+  if (status_ == Status::kSuccess) {
+    status_ = file_handler_->Append(trailer, kBlockTrailerSize);
+  }
   if (status_ == Status::kSuccess) {
     //更新写入偏移
     block_offset_ += offset_size.length + kBlockTrailerSize;
   }
 }
+//提交一个data block进行压缩，有压缩线程池时异步执行，否则直接在当前线程完成
+void TableBuilder::SubmitBlock(const std::shared_ptr<PendingBlock>& block) {
+  const BlockCompressType type = compression_dict_
+                                     ? kLZDictCompression
+                                     : options_.block_compress_type;
+  const lz::Dictionary* dict = compression_dict_.get();
+  const ChecksumType checksum_type = options_.checksum_type;
+  auto compress = [block, type, dict, checksum_type]() {
+    std::string output;
+    const BlockCompressType actual =
+        CompressBlock(block->contents, type, dict, &output);
+    if (!output.empty()) {
+      block->contents.swap(output);
+    }
+    BuildBlockTrailer(block->contents, actual, checksum_type, block->trailer);
+  };
+  block->submitted = true;
+  if (!options_.compress_pool) {
+    compress();
+    block->done = true;
+    return;
+  }
+  {
+    ScopedLockImpl<MutexLock> lock_guard(compress_mutex_);
+    ++running_compress_;
+  }
+  options_.compress_pool->Schedule([this, block, compress]() {
+    compress();
+    ScopedLockImpl<MutexLock> lock_guard(compress_mutex_);
+    block->done = true;
+    --running_compress_;
+    compress_cv_.SignalAll();
+  });
+}
+//按顺序把已经压缩好的block写入文件，同时补上这些block的index
+//wait_all为true时等待所有block写完，否则只在排队的block超过上限时等待
+void TableBuilder::WriteCompletedBlocks(bool wait_all) {
+  bool written = false;
+  while (!pending_blocks_.empty()) {
+    std::shared_ptr<PendingBlock> block = pending_blocks_.front();
+    if (!block->submitted) {
+      break;
+    }
+    {
+      ScopedLockImpl<MutexLock> lock_guard(compress_mutex_);
+      while (!block->done &&
+             (wait_all || pending_blocks_.size() > max_pending_blocks_)) {
+        compress_cv_.Wait();
+      }
+      if (!block->done) {
+        break;
+      }
+    }
+    pending_blocks_.pop_front();
+    if (status_ != Status::kSuccess) {
+      continue;
+    }
+    AppendBlock(block->contents, block->trailer, pre_block_offset_size_);
+    last_block_filter_key_end_ = block->filter_key_end;
+    if (!options_.partition_index_and_filters) {
+      filter_block_builder_.AddBlock(pre_block_offset_size_.offset,
+                                     block->filter_key_end);
+    }
+    written = true;
+    // 最后一个block的index key要等到下一个key到来时才能确定
+    if (!block->index_key.empty()) {
+      AddIndexEntry(block->index_key, pre_block_offset_size_,
+                    block->filter_key_end);
+    }
+  }
+  // 对于批量写缓冲区剩余的数据需要手动进行刷盘，至此一个block才能保证全部落盘
+  // direct io每次写入都要对齐，异步写由后台线程写出写满的缓冲区，
+  // 这两种情况攒满缓冲区再写，Finish中Close时写出剩余部分
+  if (written && status_ == Status::kSuccess && !file_handler_->IsDirectIo() &&
+      !file_handler_->IsAsync()) {
+    status_ = file_handler_->FlushBuffer();
+  }
+}
+//用缓存的样本block训练字典，然后把这些block交给压缩流水线
+void TableBuilder::FinishCompressionDict() {
+  train_compression_dict_ = false;
+  std::vector<std::string_view> samples;
+  samples.reserve(pending_blocks_.size());
+  for (const auto& block : pending_blocks_) {
+    samples.emplace_back(block->contents);
+  }
+  std::string dict =
+      lz::TrainDictionary(samples, options_.compression_dict_size);
+  if (!dict.empty()) {
+    compression_dict_ = std::make_unique<lz::Dictionary>(std::move(dict));
+  }
+  sample_bytes_ = 0;
+  for (const auto& block : pending_blocks_) {
+    SubmitBlock(block);
+  }
+  WriteCompletedBlocks(false);
+}
+//添加一条index，分区索引时index分区达到大小就落盘
+void TableBuilder::AddIndexEntry(const std::string& key,
+                                 const OffSetSize& handle,
+                                 uint64_t filter_key_end) {
+  std::string output;
+  // index中的value保存的是当前key在block中的偏移量和对应的block大小
+  index_block_offset_size_builder_.Encode(handle, output);
+  index_block_builder_.Add(key, output);
+  if (options_.partition_index_and_filters) {
+    last_index_key_ = key;
+    if (index_block_builder_.CurrentSize() >= options_.metadata_block_size) {
+      FinishIndexPartition(filter_key_end);
+    }
+  }
+}
+//把当前的index分区和对应的filter分区落盘，并记录到顶层索引中
+//filter分区包含这个index分区覆盖的所有data block中的key
+void TableBuilder::FinishIndexPartition(uint64_t filter_key_end) {
+  if (index_block_builder_.Data().empty()) {
+    return;
+  }
+  OffSetSize partition_handle;
+  WriteDataBlock(index_block_builder_, options_.block_compress_type,
+                 partition_handle);
+  std::string handle_encoding;
+  index_block_offset_size_builder_.Encode(partition_handle, handle_encoding);
+  top_index_block_builder_.Add(last_index_key_, handle_encoding);
+  if (filter_block_builder_.Availabe()) {
+    std::string filter_data;
+    filter_block_builder_.FinishPartition(filter_key_end, &filter_data);
+    OffSetSize filter_handle;
+    WriteBytesBlock(filter_data, BlockCompressType::kNonCompress,
+                    filter_handle);
+    handle_encoding.clear();
+    index_block_offset_size_builder_.Encode(filter_handle, handle_encoding);
+    top_filter_block_builder_.Add(last_index_key_, handle_encoding);
+  }
+}
 //结束一个sst文件（写入filter_block meta_filter index_block和最后footer）
 void TableBuilder::Finish() {
   if (!Success()) {
@@ -120,11 +341,41 @@ void TableBuilder::Finish() {
   }
   // 把data buffer中剩余的数据刷到磁盘
   Flush();
+  // 样本量不够时用已有的block训练字典
+  if (train_compression_dict_) {
+    FinishCompressionDict();
+  }
+  // 等待压缩流水线中所有的data block落盘
+  WriteCompletedBlocks(true);
+  // 处理最后一个block的index
+  if (need_create_index_block_ && options_.comparator) {
+    // 最后一个key不做优化了，直接使用(leveldb中是FindShortSuccessor(std::string*
+    // key)函数)
+    AddIndexEntry(pre_block_last_key_, pre_block_offset_size_,
+                  last_block_filter_key_end_);
+    need_create_index_block_ = false;
+  }
+  const bool partitioned = options_.partition_index_and_filters;
+  if (partitioned) {
+    // 剩余的index和所有还没有生成分区的key
+    FinishIndexPartition(filter_block_builder_.KeyNum());
+  }
   OffSetSize filter_block_offset, meta_filter_block_offset, index_block_offset;
+  // meta block中的数据需要按key有序
+  std::map<std::string, std::string> meta_entries;
+  OffsetBuilder meta_offset_builder;//block位置属性编解码
   // 开始构建filter_block和meta_filter_block_offset(这部分其实保存到footer中)
   //写filter_block数据
-  if (filter_block_builder_.Availabe()) {
-    // 这部分写的是filter即布隆过滤器部分数据
+  if (filter_block_builder_.Availabe() && partitioned) {
+    // 分区过滤器只需要写入顶层索引
+    WriteDataBlock(top_filter_block_builder_, options_.block_compress_type,
+                   filter_block_offset);
+    meta_offset_builder.Encode(
+        filter_block_offset,
+        meta_entries[std::string(kPartitionedFilterPrefix) +
+                     options_.filter_policy->Name()]);
+  } else if (filter_block_builder_.Availabe()) {
+    // 这部分写的是按block偏移划分的filter
     filter_block_builder_.Finish();
     const auto& filter_block_data = filter_block_builder_.Data();
 
@@ -133,32 +384,38 @@ void TableBuilder::Finish() {
                     filter_block_offset);
     // 该部分是获取布隆过滤器部分数据在整个sst中的位置，然后将这部分数据写入到sst中
     // 这部分目的是针对不同的块可以使用不同的filter_policy
+    meta_offset_builder.Encode(
+        filter_block_offset,
+        meta_entries[std::string(kBlockFilterPrefix) +
+                     options_.filter_policy->Name()]);
+  }
+  // 压缩字典不压缩，读取时在解压data block之前加载
+  if (compression_dict_) {
+    OffSetSize dict_block_offset;
+    WriteBytesBlock(compression_dict_->Data(), BlockCompressType::kNonCompress,
+                    dict_block_offset);
+    meta_offset_builder.Encode(dict_block_offset,
+                               meta_entries[kCompressionDictKey]);
+  }
+  if (partitioned) {
+    meta_entries[kIndexTypeKey] = kTwoLevelIndexType;
+  }
+  if (!meta_entries.empty()) {
     DataBlockBuilder meta_filter_block(&options_);//构建block
-    OffsetBuilder filter_block_offset_builder;//block位置属性编解码
-    std::string handle_encoding_str;
-    filter_block_offset_builder.Encode(filter_block_offset,
-                                       handle_encoding_str);
-    //meta_filter_block只有一条kv数据
-    //加到缓冲区
-    meta_filter_block.Add(options_.filter_policy->Name(), handle_encoding_str);
+    for (const auto& [key, handle] : meta_entries) {
+      meta_filter_block.Add(key, handle);
+    }
     //落盘
-    WriteDataBlock(meta_filter_block, meta_filter_block_offset);
-  }
-  // 处理index_block
-  if (need_create_index_block_ && options_.comparator) {
-    // 最后一个key不做优化了，直接使用(leveldb中是FindShortSuccessor(std::string*
-    // key)函数)
-    // index中的value保存的是当前key在block中的偏移量和对应的block大小
-    std::string output;
-    index_block_offset_size_builder_.Encode(pre_block_offset_size_, output);
-    index_block_builder_.Add(pre_block_last_key_, output);
-    need_create_index_block_ = false;
+    WriteDataBlock(meta_filter_block, options_.block_compress_type,
+                   meta_filter_block_offset);
   }
-  //index_block落盘
-  WriteDataBlock(_builder_, index_block_offset);
-  Footer footer;//最后一块定长40个字节
+  //index_block落盘，分区索引时footer中记录的是顶层索引
+  WriteDataBlock(partitioned ? top_index_block_builder_ : index_block_builder_,
+                 options_.block_compress_type, index_block_offset);
+  Footer footer;//最后一块定长48个字节
   footer.SetFilterBlockMetaData(meta_filter_block_offset);
   footer.SetIndexBlockMetaData(index_block_offset);
+  footer.SetChecksumType(options_.checksum_type);
   std::string footer_output;
   footer.EncodeTo(&footer_output);
   //直接写入文件
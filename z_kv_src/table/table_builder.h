@@ -1,8 +1,14 @@
 #pragma once
+#include <deque>
+#include <memory>
+
 #include "../db/options.h"
 #include "../file/file.h"
+#include "../utils/lz_compress.h"
+#include "../utils/mutex.h"
 #include "block_builder.h"
 #include "offset_size.h"
+#include "table_options.h"
 namespace z_kv {
 struct Options;
 }  // namespace corekv
@@ -13,6 +19,12 @@ class TableBuilder final {
   TableBuilder(const TableBuilder&) = delete;
   TableBuilder& operator=(const TableBuilder&) = delete;
   TableBuilder(const Options& options,FileWriter* file_handler);
+  // 使用输出层level对应的属性(压缩、字典、block大小、过滤器)构建sst
+  TableBuilder(const Options& options, FileWriter* file_handler, int32_t level);
+  ~TableBuilder();
+  // 按options创建flush/compaction输出sst的FileWriter
+  static std::unique_ptr<FileWriter> NewFileWriter(const Options& options,
+                                                   const std::string& file_name);
   void Add(const std::string_view& key, const std::string_view& value);
   // Finish是指Add最后，有一部分数据还没来得及刷盘
   void Finish();
@@ -23,9 +35,23 @@ class TableBuilder final {
   uint32_t GetEntryNum() {
     return entry_count_;
   }
+  // sst中最小和最大的key，写入manifest用于文件裁剪
+  const std::string& GetSmallestKey() { return smallest_key_; }
+  const std::string& GetLargestKey() { return largest_key_; }
  private:
   void Flush();
-  void WriteDataBlock(DataBlockBuilder& data_block, OffSetSize& offset_size);
+  void WriteDataBlock(DataBlockBuilder& data_block,
+                      BlockCompressType block_compress_type,
+                      OffSetSize& offset_size);
+  void AppendBlock(const std::string& block_contents, const char* trailer,
+                   OffSetSize& offset_size);
+  void FinishCompressionDict();
+  void AddIndexEntry(const std::string& key, const OffSetSize& handle,
+                     uint64_t filter_key_end);
+  void FinishIndexPartition(uint64_t filter_key_end);
+  struct PendingBlock;
+  void SubmitBlock(const std::shared_ptr<PendingBlock>& block);
+  void WriteCompletedBlocks(bool wait_all);
   void WriteBytesBlock(const std::string& datas,
                        BlockCompressType block_compress_type,
                        OffSetSize& offset_size);
@@ -41,6 +67,11 @@ class TableBuilder final {
   DataBlockBuilder index_block_builder_;
   //filter_block构建器
   FilterBlockBuilder filter_block_builder_;
+  // 分区索引时的顶层index和顶层filter索引，key都是对应index分区的最后一个key
+  DataBlockBuilder top_index_block_builder_;
+  DataBlockBuilder top_filter_block_builder_;
+  // 当前index分区中最后一个key
+  std::string last_index_key_;
   //位置属性编解码
   OffsetBuilder index_block_offset_size_builder_;
   //写文件句柄，实现了批量写
@@ -53,6 +84,39 @@ class TableBuilder final {
   uint32_t block_offset_ = 0;
   //数据计数
   uint64_t entry_count_ = 0;
+  // 第一个和最后一个写入的key(key是有序写入的)
+  std::string smallest_key_;
+  std::string largest_key_;
+  // 压缩输出的缓冲区，所有block复用
+  std::string compress_output_;
+  // 等待压缩或字典训练的data block，按顺序落盘
+  struct PendingBlock {
+    // 压缩完成后替换为实际落盘的数据
+    std::string contents;
+    // 为空表示index key还没有确定
+    std::string index_key;
+    // 这个block的最后一个key是第几个加入过滤器的，用于划分filter分区
+    uint64_t filter_key_end = 0;
+    char trailer[kBlockTrailerSize];
+    // 是否已经提交压缩(训练字典期间不提交)
+    bool submitted = false;
+    // 压缩是否完成，由compress_mutex_保护
+    bool done = false;
+  };
+  std::deque<std::shared_ptr<PendingBlock>> pending_blocks_;
+  // 是否还在采集训练字典的样本
+  bool train_compression_dict_ = false;
+  uint64_t sample_bytes_ = 0;
+  // 最后一个已经落盘的block对应的filter_key_end
+  uint64_t last_block_filter_key_end_ = 0;
+  // 使用压缩线程池时最多排队的block数
+  uint32_t max_pending_blocks_ = 0;
+  // 正在后台压缩的block数
+  uint32_t running_compress_ = 0;
+  MutexLock compress_mutex_;
+  CondVar compress_cv_;
+  // sst共享的压缩字典
+  std::unique_ptr<lz::Dictionary> compression_dict_;
   //标记是否需要创建indexblock
   bool need_create_index_block_ = false;
   DBStatus status_;
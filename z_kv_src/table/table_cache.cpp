@@ -0,0 +1,85 @@
+#include "table_cache.h"
+
+#include "../file/file_name.h"
+#include "../logger/log.h"
+namespace z_kv {
+static void DeleteTableAndFile(const uint64_t&, TableAndFile* value) {
+  // 先释放table再关闭文件，table中持有的是文件句柄的裸指针
+  value->table.reset();
+  value->file.reset();
+  delete value;
+}
+
+TableCache::TableCache(const std::string& db_path, const Options* options,
+                       uint32_t max_open_files)
+    : db_path_(db_path), options_(options) {
+  // ShardCache中每个shard的容量都是capacity，这里按shard均分文件句柄的额度
+  static constexpr uint32_t kShardNum =
+      ShardCache<uint64_t, TableAndFile>::kShardNum;
+  uint32_t capacity = (max_open_files + kShardNum - 1) / kShardNum;
+  if (capacity == 0) {
+    capacity = 1;
+  }
+  cache_ = std::make_unique<ShardCache<uint64_t, TableAndFile>>(capacity);
+  cache_->RegistCleanHandle(DeleteTableAndFile);
+}
+
+DBStatus TableCache::FindTable(uint64_t sst_id, uint64_t file_size,
+                               Handle** handle) {
+  if (!handle) {
+    return Status::kInvalidObject;
+  }
+  *handle = cache_->Get(sst_id);
+  if (*handle != nullptr) {
+    return Status::kSuccess;
+  }
+  const auto& sst_filename = FileName::FileNameSSTable(db_path_, sst_id);
+  if (!FileTool::Exist(sst_filename)) {
+    LOG(LogLevel::ERROR, "sst[%s] don't existed!", sst_filename.c_str());
+    return Status::kNotFound;
+  }
+  if (file_size == 0) {
+    file_size = FileTool::GetFileSize(sst_filename);
+  }
+  auto* table_and_file = new TableAndFile();
+  table_and_file->file =
+      std::make_unique<FileReader>(sst_filename, options_->use_mmap_reads);
+  // 点查为主，关闭内核预读避免读入不需要的页，
+  // 迭代器顺序扫描时由reader自己检测并发起预读
+  table_and_file->file->Advise(FileReader::kRandom);
+  table_and_file->file->EnableAutoReadahead(options_->max_auto_readahead_size);
+  table_and_file->table = std::make_unique<Table>(
+      options_, table_and_file->file.get(), sst_id);
+  auto status = table_and_file->table->Open(file_size);
+  if (status == Status::kSuccess) {
+    status = table_and_file->table->WarmUp();
+  }
+  if (status != Status::kSuccess) {
+    // 打开失败不进入缓存，下次访问时重新尝试
+    DeleteTableAndFile(sst_id, table_and_file);
+    return status;
+  }
+  cache_->Insert(sst_id, table_and_file);
+  *handle = cache_->Get(sst_id);
+  return *handle != nullptr ? Status::kSuccess : Status::kNotFound;
+}
+
+void TableCache::Release(Handle* handle) {
+  if (handle) {
+    cache_->Release(handle);
+  }
+}
+
+void TableCache::Evict(uint64_t sst_id) { cache_->Erase(sst_id); }
+
+std::unique_ptr<FileReader> TableCache::NewCompactionReader(
+    const Options& options, const std::string& file_name) {
+  auto reader = std::make_unique<FileReader>(
+      file_name, false, options.use_direct_io_for_flush_and_compaction);
+  // 顺序读取整个文件，用固定的预读缓冲区减少系统调用
+  if (options.compaction_readahead_size > 0) {
+    reader->SetReadaheadBuffer(options.compaction_readahead_size);
+  }
+  return reader;
+}
+}  // namespace corekv
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "../cache/cache.h"
+#include "../db/options.h"
+#include "../file/file.h"
+#include "table.h"
+namespace z_kv {
+// 缓存中保存的对象：文件句柄以及解析好的table(index block和布隆过滤器)
+struct TableAndFile {
+  std::unique_ptr<FileReader> file;
+  std::unique_ptr<Table> table;
+};
+// 以sst_id为key缓存已经打开的table，避免每次访问都重新读取footer、
+// index block和filter。缓存的容量就是打开文件句柄的上限，淘汰时关闭文件
+class TableCache final {
+ public:
+  using Handle = CacheNode<uint64_t, TableAndFile>;
+  TableCache(const std::string& db_path, const Options* options,
+             uint32_t max_open_files);
+  TableCache(const TableCache&) = delete;
+  TableCache& operator=(const TableCache&) = delete;
+  ~TableCache() = default;
+  // file_size为0时从文件系统中获取，返回的handle使用完之后需要调用Release
+  DBStatus FindTable(uint64_t sst_id, uint64_t file_size, Handle** handle);
+  Table* GetTable(Handle* handle) { return handle->value->table.get(); }
+  void Release(Handle* handle);
+  // sst被删除之后调用，缓存中的句柄在最后一个使用者释放后关闭
+  void Evict(uint64_t sst_id);
+  // 按options打开compaction的输入sst，只有一个线程顺序读取，不经过缓存
+  static std::unique_ptr<FileReader> NewCompactionReader(
+      const Options& options, const std::string& file_name);
+
+ private:
+  std::string db_path_;
+  const Options* options_;
+  std::unique_ptr<Cache<uint64_t, TableAndFile>> cache_;
+};
+}  // namespace corekv
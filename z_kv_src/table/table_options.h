@@ -3,12 +3,38 @@
 namespace z_kv {
 // echo http://www.hardcore.com/corekv | sha1sum
 static constexpr uint64_t kTableMagicNumber = 0x04452b9527c24933ull;
+// 带校验算法的footer使用新的magic，旧的40字节footer校验算法固定为crc32c
+static constexpr uint64_t kTableMagicNumberV2 = 0x04452b9527c24934ull;
 static constexpr uint32_t kMaxVarInt64Length = 10;
 static constexpr uint32_t kMaxOffSetSizeLength = 2 * kMaxVarInt64Length;
 // footer的长度
 // static constexpr uint64_t kEncodedLength =
 //     2 * kMaxOffSetSizeLength + 8;
-static constexpr uint64_t kEncodedLength = 40;
-// 1-byte type + 32-bit crc
+// |filter handle(16)|index handle(16)|校验算法(fixed32)|保留(fixed32)|magic(8)|
+static constexpr uint64_t kEncodedLength = 48;
+// 旧版本的footer：|filter handle(16)|index handle(16)|magic(8)|
+static constexpr uint64_t kLegacyEncodedLength = 40;
+// 1-byte type + 32-bit checksum(算法由footer中的ChecksumType决定)
 static constexpr size_t kBlockTrailerSize = 5;
+// data block尾部restart个数的最高位表示block带有hash索引
+// 格式：|entries|restarts|buckets(uint16)|bucket个数(fixed32)|restart个数(fixed32)|
+static constexpr uint32_t kDataBlockHashIndexFlag = 1u << 31;
+// hash索引使用hash_util::Hash64(kHash64Version = 1)，没有这一位的旧block使用SimMurMurHash
+static constexpr uint32_t kDataBlockHash64Flag = 1u << 30;
+// bucket中保存的是(restart下标 << 8) | entry在restart中的下标
+static constexpr uint16_t kHashBucketEmpty = 0xFFFF;
+static constexpr uint16_t kHashBucketCollision = 0xFFFE;
+// restart下标和entry下标各用一个字节保存，超过时不构建hash索引
+static constexpr uint32_t kMaxHashIndexRestarts = 255;
+static constexpr uint32_t kMaxHashIndexRestartInterval = 256;
+// 按block偏移划分的filter在meta block中的key为前缀+过滤器名字，
+// 不带前缀的是旧版本整个sst一个的布隆过滤器
+static constexpr char kBlockFilterPrefix[] = "filter.";
+// meta block中记录index类型的key，分区索引时value为kTwoLevelIndexType
+static constexpr char kIndexTypeKey[] = "z_kv.index_type";
+static constexpr char kTwoLevelIndexType[] = "two_level";
+// 分区过滤器的顶层索引在meta block中的key为前缀+过滤器名字
+static constexpr char kPartitionedFilterPrefix[] = "partitioned.";
+// meta block中压缩字典对应的key
+static constexpr char kCompressionDictKey[] = "z_kv.compression_dict";
 }  // namespace corekv
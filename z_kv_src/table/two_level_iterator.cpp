@@ -0,0 +1,129 @@
+#include "two_level_iterator.h"
+
+#include <memory>
+#include <string>
+namespace z_kv {
+namespace {
+class TwoLevelIterator final : public Iterator {
+ public:
+  TwoLevelIterator(Iterator* index_iter, BlockFunction block_function)
+      : index_iter_(index_iter), block_function_(std::move(block_function)) {}
+  ~TwoLevelIterator() override = default;
+
+  bool Valid() const override { return data_iter_ && data_iter_->Valid(); }
+  void Seek(const std::string_view& target) override {
+    index_iter_->Seek(target);
+    InitDataBlock();
+    if (data_iter_) {
+      data_iter_->Seek(target);
+    }
+    SkipEmptyDataBlocksForward();
+  }
+  void SeekToFirst() override {
+    index_iter_->SeekToFirst();
+    InitDataBlock();
+    if (data_iter_) {
+      data_iter_->SeekToFirst();
+    }
+    SkipEmptyDataBlocksForward();
+  }
+  void SeekToLast() override {
+    index_iter_->SeekToLast();
+    InitDataBlock();
+    if (data_iter_) {
+      data_iter_->SeekToLast();
+    }
+    SkipEmptyDataBlocksBackward();
+  }
+  void Next() override {
+    assert(Valid());
+    data_iter_->Next();
+    SkipEmptyDataBlocksForward();
+  }
+  void Prev() override {
+    assert(Valid());
+    data_iter_->Prev();
+    SkipEmptyDataBlocksBackward();
+  }
+  std::string_view key() const override {
+    assert(Valid());
+    return data_iter_->key();
+  }
+  std::string_view value() const override {
+    assert(Valid());
+    return data_iter_->value();
+  }
+  DBStatus status() const override {
+    if (index_iter_->status() != Status::kSuccess) {
+      return index_iter_->status();
+    }
+    if (data_iter_ && data_iter_->status() != Status::kSuccess) {
+      return data_iter_->status();
+    }
+    return status_;
+  }
+
+ private:
+  // 当前block遍历完之后移动到下一个非空的block
+  void SkipEmptyDataBlocksForward() {
+    while (!data_iter_ || !data_iter_->Valid()) {
+      if (!index_iter_->Valid()) {
+        SetDataIterator(nullptr);
+        return;
+      }
+      index_iter_->Next();
+      InitDataBlock();
+      if (data_iter_) {
+        data_iter_->SeekToFirst();
+      }
+    }
+  }
+  void SkipEmptyDataBlocksBackward() {
+    while (!data_iter_ || !data_iter_->Valid()) {
+      if (!index_iter_->Valid()) {
+        SetDataIterator(nullptr);
+        return;
+      }
+      index_iter_->Prev();
+      InitDataBlock();
+      if (data_iter_) {
+        data_iter_->SeekToLast();
+      }
+    }
+  }
+  void SetDataIterator(Iterator* data_iter) {
+    if (data_iter_ && data_iter_->status() != Status::kSuccess &&
+        status_ == Status::kSuccess) {
+      status_ = data_iter_->status();
+    }
+    data_iter_.reset(data_iter);
+  }
+  // 根据index当前指向的位置创建block迭代器，和当前block相同时复用
+  void InitDataBlock() {
+    if (!index_iter_->Valid()) {
+      SetDataIterator(nullptr);
+      return;
+    }
+    const std::string_view handle = index_iter_->value();
+    if (data_iter_ && handle == data_block_handle_) {
+      return;
+    }
+    SetDataIterator(block_function_(handle));
+    data_block_handle_.assign(handle.data(), handle.size());
+  }
+
+ private:
+  std::unique_ptr<Iterator> index_iter_;
+  BlockFunction block_function_;
+  std::unique_ptr<Iterator> data_iter_;
+  // data_iter_对应的index value，用于判断是否需要切换block
+  std::string data_block_handle_;
+  DBStatus status_ = Status::kSuccess;
+};
+}  // namespace
+
+Iterator* NewTwoLevelIterator(Iterator* index_iter,
+                              BlockFunction block_function) {
+  return new TwoLevelIterator(index_iter, std::move(block_function));
+}
+}  // namespace corekv
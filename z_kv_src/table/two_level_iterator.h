@@ -0,0 +1,14 @@
+#pragma once
+#include <functional>
+#include <string_view>
+
+#include "../db/iterator.h"
+namespace z_kv {
+// 根据index中的value(block的位置信息)创建对应block的迭代器
+using BlockFunction = std::function<Iterator*(const std::string_view&)>;
+// 两层迭代器：第一层遍历index，第二层遍历index指向的block
+// 用于sst的整体遍历(index->data block)，以及分区索引(顶层index->index分区)
+// 接管index_iter的所有权
+Iterator* NewTwoLevelIterator(Iterator* index_iter,
+                              BlockFunction block_function);
+}  // namespace corekv
@@ -15,6 +15,18 @@
 
 using namespace std;
 using namespace z_kv;
+// 统计堆内存分配次数，用于检查迭代过程中没有额外的内存分配
+static size_t g_alloc_count = 0;
+void* operator new(size_t size) {
+  ++g_alloc_count;
+  void* ptr = malloc(size);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
 TEST(ITER_TEST, block_iter) {
   vector<string> kTestKeys = {};
   for (int i = 0; i < 1900; ++i) {
@@ -72,3 +84,78 @@ TEST(ITER_TEST, block_iter) {
   cout << endl;
   delete dataBlock;
 }
+TEST(ITER_TEST, hash_index) {
+  vector<string> keys;
+  for (int i = 0; i < 1000; ++i) {
+    keys.emplace_back("key" + to_string(i));
+  }
+  sort(keys.begin(), keys.end());
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  Options hash_options = options;
+  hash_options.data_block_hash_ratio = 0.75;
+  DataBlockBuilder hash_builder(&hash_options);
+  DataBlockBuilder plain_builder(&options);
+  for (const auto& k : keys) {
+    hash_builder.Add(k, "value_" + k);
+    plain_builder.Add(k, "value_" + k);
+  }
+  hash_builder.Finish();
+  plain_builder.Finish();
+  EXPECT_GT(hash_builder.Data().size(), plain_builder.Data().size());
+
+  for (const string& data : {hash_builder.Data(), plain_builder.Data()}) {
+    DataBlock block(data);
+    Iterator* iter = block.NewIterator(options.comparator);
+    // 存在的key一次定位
+    for (const auto& k : keys) {
+      ASSERT_TRUE(iter->SeekForGet(k));
+      ASSERT_TRUE(iter->Valid());
+      EXPECT_EQ(iter->key(), k);
+      EXPECT_EQ(iter->value(), "value_" + k);
+    }
+    // 不存在的key
+    for (int i = 0; i < 1000; ++i) {
+      const string missing = "key" + to_string(i) + "_missing";
+      if (iter->SeekForGet(missing)) {
+        EXPECT_TRUE(!iter->Valid() || iter->key() != missing);
+      } else {
+        EXPECT_FALSE(iter->Valid());
+      }
+    }
+    // 范围查询不受hash索引影响
+    int count = 0;
+    for (iter->Seek(keys[10]); iter->Valid(); iter->Next()) {
+      EXPECT_EQ(iter->key(), keys[10 + count]);
+      ++count;
+    }
+    EXPECT_EQ(count, keys.size() - 10);
+    delete iter;
+  }
+}
+TEST(ITER_TEST, zero_copy_scan) {
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  DataBlockBuilder builder(&options);
+  char key[64];
+  for (int i = 0; i < 2000; ++i) {
+    snprintf(key, sizeof(key), "a_rather_long_shared_key_prefix_%08d", i);
+    builder.Add(key, string(100, 'v'));
+  }
+  builder.Finish();
+  DataBlock block(builder.Data());
+  Iterator* iter = block.NewIterator(options.comparator);
+  size_t entry_num = 0, value_bytes = 0;
+  // 第一次扩展key的缓冲区之后，整个扫描过程不再分配内存
+  iter->SeekToFirst();
+  iter->Next();
+  const size_t alloc_count = g_alloc_count;
+  for (; iter->Valid(); iter->Next()) {
+    ++entry_num;
+    value_bytes += iter->value().size();
+  }
+  EXPECT_EQ(g_alloc_count, alloc_count);
+  EXPECT_EQ(entry_num, 1999);
+  EXPECT_EQ(value_bytes, 1999 * 100);
+  delete iter;
+}
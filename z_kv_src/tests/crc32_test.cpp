@@ -0,0 +1,89 @@
+#include "utils/crc32.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace z_kv;
+static string MakeData(size_t len) {
+  string data;
+  for (size_t index = 0; index < len; ++index) {
+    data.push_back(static_cast<char>(index * 131 + 7));
+  }
+  return data;
+}
+// 硬件和查表两种实现都要满足标准的CRC32C测试向量
+TEST(crc32Test, StandardResults) {
+  for (const bool accelerate : {false, true}) {
+    crc32::EnableAcceleration(accelerate);
+    char buf[32];
+    memset(buf, 0, sizeof(buf));
+    EXPECT_EQ(0x8a9136aaU, crc32::Value(buf, sizeof(buf)));
+    memset(buf, 0xff, sizeof(buf));
+    EXPECT_EQ(0x62a8ab43U, crc32::Value(buf, sizeof(buf)));
+    for (int i = 0; i < 32; i++) {
+      buf[i] = i;
+    }
+    EXPECT_EQ(0x46dd794eU, crc32::Value(buf, sizeof(buf)));
+    EXPECT_EQ(0xe3069283U, crc32::Value("123456789", 9));
+    EXPECT_EQ(0xdcbc59faU, crc32::Value("TestCRCBuffer", 13));
+    EXPECT_EQ(crc32::Value("hello world", 11),
+              crc32::Extend(crc32::Value("hello ", 6), "world", 5));
+  }
+  crc32::EnableAcceleration(true);
+}
+// 覆盖对齐前缀、3路并行(长短两种段)和尾部的各种组合
+TEST(crc32Test, AcceleratedMatchesTable) {
+  const string data = MakeData(3 * 8192 * 2 + 3 * 256 + 64);
+  auto check = [&data](size_t offset, size_t len) {
+    crc32::EnableAcceleration(false);
+    const uint32_t table = crc32::Extend(0x12345678, data.data() + offset, len);
+    crc32::EnableAcceleration(true);
+    EXPECT_EQ(crc32::Extend(0x12345678, data.data() + offset, len), table)
+        << offset << " " << len;
+  };
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t len = 0; len <= 3 * 256 * 2 + 32; ++len) {
+      check(offset, len);
+    }
+    for (const size_t len : {4096, 3 * 8192 - 1, 3 * 8192, 3 * 8192 + 9,
+                             3 * 8192 * 2 + 3 * 256 + 7}) {
+      check(offset, len);
+    }
+  }
+}
+TEST(crc32Test, Mask) {
+  const uint32_t crc = crc32::Value("foo", 3);
+  EXPECT_NE(crc, crc32::Mask(crc));
+  EXPECT_NE(crc, crc32::Mask(crc32::Mask(crc)));
+  EXPECT_EQ(crc, crc32::Unmask(crc32::Mask(crc)));
+  EXPECT_EQ(crc, crc32::Unmask(crc32::Unmask(crc32::Mask(crc32::Mask(crc)))));
+}
+// 吞吐对比：block大小(4KB)和大块(1MB)
+// 只输出吞吐不做检查，默认不运行，使用--gtest_also_run_disabled_tests手动运行
+TEST(crc32Test, DISABLED_Throughput) {
+  for (const size_t len : {4096, 1 << 20}) {
+    const string data = MakeData(len);
+    const size_t rounds = (256u << 20) / len;
+    uint32_t sink = 0;
+    double seconds[2];
+    for (const bool accelerate : {false, true}) {
+      crc32::EnableAcceleration(accelerate);
+      auto start = chrono::steady_clock::now();
+      for (size_t index = 0; index < rounds; ++index) {
+        sink += crc32::Value(data.data(), len);
+      }
+      seconds[accelerate] =
+          chrono::duration<double>(chrono::steady_clock::now() - start)
+              .count();
+    }
+    const double bytes = static_cast<double>(rounds) * len;
+    cout << "len=" << len << " table=" << bytes / seconds[0] / 1e9
+         << "GB/s accelerated=" << bytes / seconds[1] / 1e9 << "GB/s"
+         << " (" << sink % 10 << ")" << endl;
+  }
+  crc32::EnableAcceleration(true);
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "filter/blocked_bloomfilter.h"
+#include "filter/bloomfilter.h"
+#include "filter/xor_filter.h"
+#include "utils/hash_util.h"
+using namespace std;
+using namespace z_kv;
+// 过滤器的误判率和探测耗时对比
+static constexpr int32_t kKeyNum = 200000;
+static constexpr int32_t kProbeNum = 1000000;
+static constexpr int32_t kBitsPerKey = 10;
+struct FilterBenchResult {
+  size_t bytes = 0;
+  double false_positive_rate = 0;
+  double probe_ns = 0;
+};
+static vector<string> MakeKeys(const string& prefix, int32_t num) {
+  vector<string> keys;
+  keys.reserve(num);
+  for (int32_t index = 0; index < num; ++index) {
+    keys.emplace_back(prefix + to_string(index));
+  }
+  return keys;
+}
+// 过滤器只使用key的64位hash构建
+static vector<uint64_t> HashKeys(const vector<string>& keys) {
+  vector<uint64_t> hashes;
+  hashes.reserve(keys.size());
+  for (const auto& key : keys) {
+    hashes.push_back(hash_util::Hash64(key.data(), key.size()));
+  }
+  return hashes;
+}
+static FilterBenchResult RunFilterBench(FilterPolicy* policy,
+                                        const vector<string>& keys,
+                                        const vector<string>& missing) {
+  FilterBenchResult result;
+  string filter;
+  const auto hashes = HashKeys(keys);
+  policy->CreateFilter(hashes.data(), hashes.size(), &filter);
+  result.bytes = filter.size();
+  for (const auto& key : keys) {
+    EXPECT_TRUE(policy->MayMatch(key, filter)) << key;
+  }
+  int32_t false_positive = 0;
+  const auto start = chrono::steady_clock::now();
+  for (int32_t index = 0; index < kProbeNum; ++index) {
+    false_positive += policy->MayMatch(missing[index % missing.size()], filter);
+  }
+  const auto cost = chrono::steady_clock::now() - start;
+  result.false_positive_rate = static_cast<double>(false_positive) / kProbeNum;
+  result.probe_ns =
+      chrono::duration<double, nano>(cost).count() / kProbeNum;
+  cout << policy->Name() << ": bytes=" << result.bytes << " bits_per_key="
+       << result.bytes * 8.0 / keys.size()
+       << " fpr=" << result.false_positive_rate
+       << " probe_ns=" << result.probe_ns << endl;
+  return result;
+}
+TEST(filterBenchTest, BloomVsBlockedBloom) {
+  const auto keys = MakeKeys("key", kKeyNum);
+  const auto missing = MakeKeys("missing", kKeyNum);
+  BloomFilter bloom(kBitsPerKey);
+  BlockedBloomFilter blocked(kBitsPerKey);
+  const auto bloom_result = RunFilterBench(&bloom, keys, missing);
+  BlockedBloomFilter::EnableSimd(false);
+  const auto scalar_result = RunFilterBench(&blocked, keys, missing);
+  BlockedBloomFilter::EnableSimd(true);
+  const auto simd_result = RunFilterBench(&blocked, keys, missing);
+  // 标量和SIMD的探测结果必须一致
+  EXPECT_EQ(scalar_result.false_positive_rate, simd_result.false_positive_rate);
+  // 分块之后误判率略高，但是在同一个量级
+  EXPECT_LT(bloom_result.false_positive_rate, 0.02);
+  EXPECT_LT(simd_result.false_positive_rate, 0.02);
+}
+TEST(filterBenchTest, BlockedBloomSmallFilter) {
+  BlockedBloomFilter blocked(kBitsPerKey);
+  const vector<string> keys = {"corekv", "corekv1", "corekv2"};
+  string filter;
+  const auto hashes = HashKeys(keys);
+  blocked.CreateFilter(hashes.data(), hashes.size(), &filter);
+  // 至少一个块加上探测次数
+  EXPECT_EQ(filter.size(), BlockedBloomFilter::kBlockBytes + 4);
+  for (const auto& key : keys) {
+    EXPECT_TRUE(blocked.MayMatch(key, filter));
+  }
+  blocked.CreateFilter(keys.data(), keys.size());
+  for (const auto& key : keys) {
+    EXPECT_TRUE(blocked.MayMatch(key, 0, 0));
+  }
+}
+// 内存和误判率：xor8的误判率约1/256，和13bit/key的布隆过滤器相当
+TEST(filterBenchTest, XorVsBloomMemory) {
+  const auto keys = MakeKeys("key", kKeyNum);
+  const auto missing = MakeKeys("missing", kKeyNum);
+  XorFilter xor_filter;
+  BloomFilter bloom(13);
+  const auto xor_result = RunFilterBench(&xor_filter, keys, missing);
+  const auto bloom_result = RunFilterBench(&bloom, keys, missing);
+  EXPECT_LT(xor_result.false_positive_rate, 0.006);
+  EXPECT_LT(xor_result.bytes * 8.0 / kKeyNum, 10.0);
+  // 相同量级的误判率下节省约25%的空间
+  EXPECT_LT(xor_result.bytes, bloom_result.bytes * 4 / 5);
+}
+TEST(filterBenchTest, XorSmallFilter) {
+  XorFilter xor_filter;
+  vector<string> keys = {"corekv", "corekv1", "corekv2", "corekv2"};
+  string filter;
+  const auto hashes = HashKeys(keys);
+  xor_filter.CreateFilter(hashes.data(), hashes.size(), &filter);
+  for (const auto& key : keys) {
+    EXPECT_TRUE(xor_filter.MayMatch(key, filter));
+  }
+  xor_filter.CreateFilter(keys.data(), keys.size());
+  for (const auto& key : keys) {
+    EXPECT_TRUE(xor_filter.MayMatch(key, 0, 0));
+  }
+}
@@ -1,5 +1,8 @@
 #include "table/footer.h"
 
+#include "table/table_options.h"
+#include "utils/codec.h"
+
 #include <gtest/gtest.h>
 
 #include <iostream>
@@ -19,10 +22,39 @@ TEST(footerTest, EncodeTo) {
   Footer footer;
   footer.SetFilterBlockMetaData(filter_block);
   footer.SetIndexBlockMetaData(index_block);
+  footer.SetChecksumType(kHash64Checksum);
   std::string dst;
   footer.EncodeTo(&dst);
-  std::string decode_str;
-  std::string_view decode_view = decode_str;
-  footer.DecodeFrom(&decode_view);
- std::cout<<"deseriablize:"<<footer.DebugString()<<std::endl;
+  EXPECT_EQ(dst.size(), kEncodedLength);
+  Footer decoded;
+  std::string_view decode_view = dst;
+  EXPECT_EQ(decoded.DecodeFrom(&decode_view), Status::kSuccess);
+  EXPECT_EQ(decoded.GetFilterBlockMetaData().offset, 11u);
+  EXPECT_EQ(decoded.GetFilterBlockMetaData().length, 12u);
+  EXPECT_EQ(decoded.GetIndexBlockMetaData().offset, 34u);
+  EXPECT_EQ(decoded.GetIndexBlockMetaData().length, 36u);
+  EXPECT_EQ(decoded.GetChecksumType(), kHash64Checksum);
+ std::cout<<"deseriablize:"<<decoded.DebugString()<<std::endl;
+}
+// 旧的40字节footer没有校验算法字段，固定为crc32c
+TEST(footerTest, DecodeLegacy) {
+  std::string legacy;
+  util::PutFixed64(&legacy, 11);
+  util::PutFixed64(&legacy, 12);
+  util::PutFixed64(&legacy, 34);
+  util::PutFixed64(&legacy, 36);
+  util::PutFixed32(&legacy,
+                   static_cast<uint32_t>(kTableMagicNumber & 0xffffffffu));
+  util::PutFixed32(&legacy, static_cast<uint32_t>(kTableMagicNumber >> 32));
+  // 按新footer的长度读取时前面多出来的是block数据
+  std::string input = std::string(8, 'x') + legacy;
+  Footer footer;
+  footer.SetChecksumType(kNoChecksum);
+  std::string_view decode_view = input;
+  EXPECT_EQ(footer.DecodeFrom(&decode_view), Status::kSuccess);
+  EXPECT_EQ(footer.GetIndexBlockMetaData().offset, 34u);
+  EXPECT_EQ(footer.GetIndexBlockMetaData().length, 36u);
+  EXPECT_EQ(footer.GetChecksumType(), kCRC32cChecksum);
+  std::string_view short_view(legacy.data(), legacy.size() - 1);
+  EXPECT_EQ(footer.DecodeFrom(&short_view), Status::kBadBlock);
 }
\ No newline at end of file
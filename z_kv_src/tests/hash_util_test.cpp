@@ -0,0 +1,83 @@
+#include "utils/hash_util.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cache/cache.h"
+using namespace std;
+using namespace z_kv;
+static string MakeData(size_t len) {
+  string data;
+  for (size_t index = 0; index < len; ++index) {
+    data.push_back(static_cast<char>(index * 131 + 7));
+  }
+  return data;
+}
+// Hash64的结果会写入sst(过滤器、hash索引)，修改输出必须增加kHash64Version
+TEST(hashUtilTest, Hash64Stable) {
+  static const vector<pair<size_t, uint64_t>> kGolden = {
+      {0, 0x2eac39fbc1031a68ULL},    {3, 0xa868d76586cac6a5ULL},
+      {8, 0xb3ce89f343741293ULL},    {16, 0xa0cd2a9bafe9629dULL},
+      {17, 0x55e132730c7e80aaULL},   {100, 0x73b0d2a18634f83dULL},
+      {128, 0x69982f56c937cdd6ULL},  {129, 0x2f76a9a195e6ede5ULL},
+      {1000, 0x18c7dc7737c6e043ULL}, {1024, 0xe3c5fc64be947403ULL},
+      {1025, 0x7a345a3319b0f56fULL}, {5000, 0xaf4a9f3f3a94474bULL}};
+  const string data = MakeData(5000);
+  EXPECT_EQ(hash_util::kHash64Version, 1u);
+  for (const auto& [len, hash] : kGolden) {
+    EXPECT_EQ(hash_util::Hash64(data.data(), len), hash) << len;
+  }
+}
+TEST(hashUtilTest, SimdMatchesScalar) {
+  const string data = MakeData(4096 + 64);
+  for (size_t len = 0; len <= 4096; ++len) {
+    hash_util::EnableSimd(false);
+    const uint64_t scalar = hash_util::Hash64(data.data() + 1, len, len);
+    hash_util::EnableSimd(true);
+    EXPECT_EQ(hash_util::Hash64(data.data() + 1, len, len), scalar) << len;
+  }
+}
+TEST(hashUtilTest, CacheShardBalance) {
+  // block cache的key：sst_id<<32 | block偏移，偏移都是4KB的倍数
+  static constexpr int32_t kKeyNum = 40000;
+  static constexpr int32_t kShardNum = ShardCache<uint64_t, int>::kShardNum;
+  vector<int32_t> shards(kShardNum, 0);
+  for (int32_t index = 0; index < kKeyNum; ++index) {
+    const uint64_t key = (static_cast<uint64_t>(index % 10) << 32) |
+                         (static_cast<uint64_t>(index) * 4096);
+    ++shards[CacheKeyHash(key) % kShardNum];
+  }
+  for (const auto count : shards) {
+    EXPECT_GT(count, kKeyNum / kShardNum * 9 / 10);
+    EXPECT_LT(count, kKeyNum / kShardNum * 11 / 10);
+  }
+}
+// 吞吐对比：短key(16字节)和长value(4KB)
+// 只输出吞吐不做检查，默认不运行，使用--gtest_also_run_disabled_tests手动运行
+TEST(hashUtilTest, DISABLED_Throughput) {
+  for (const size_t len : {16, 64, 4096}) {
+    const string data = MakeData(len);
+    const size_t rounds = (64u << 20) / len;
+    uint64_t sink = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t index = 0; index < rounds; ++index) {
+      sink += hash_util::SimMurMurHash(data.data(), len - (index & 1));
+    }
+    const double old_seconds =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    start = chrono::steady_clock::now();
+    for (size_t index = 0; index < rounds; ++index) {
+      sink += hash_util::Hash64(data.data(), len - (index & 1));
+    }
+    const double new_seconds =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    const double bytes = static_cast<double>(rounds) * len;
+    cout << "len=" << len << " SimMurMurHash=" << bytes / old_seconds / 1e9
+         << "GB/s Hash64=" << bytes / new_seconds / 1e9 << "GB/s"
+         << " (" << sink % 10 << ")" << endl;
+  }
+}
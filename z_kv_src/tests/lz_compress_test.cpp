@@ -0,0 +1,99 @@
+#include "utils/lz_compress.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace z_kv;
+static void CheckRoundTrip(const std::string& input) {
+  std::string compressed;
+  lz::Compress(input.data(), input.size(), &compressed);
+  size_t raw_length = 0;
+  ASSERT_TRUE(
+      lz::GetUncompressedLength(compressed.data(), compressed.size(), &raw_length));
+  EXPECT_EQ(raw_length, input.size());
+  std::string output;
+  ASSERT_TRUE(lz::Uncompress(compressed.data(), compressed.size(), &output));
+  EXPECT_EQ(output, input);
+}
+TEST(lz_compress_Test, RoundTrip) {
+  CheckRoundTrip("");
+  CheckRoundTrip("a");
+  CheckRoundTrip("abcd");
+  CheckRoundTrip(std::string(100000, 'x'));
+  std::mt19937 rnd(301);
+  std::string random_data;
+  for (int32_t i = 0; i < 70000; ++i) {
+    random_data.push_back(static_cast<char>(rnd()));
+  }
+  CheckRoundTrip(random_data);
+  std::string text;
+  for (int32_t i = 0; i < 2000; ++i) {
+    text += "user_" + std::to_string(i) + "|status=ok|region=cn-north|";
+  }
+  CheckRoundTrip(text);
+}
+TEST(lz_compress_Test, CompressRatio) {
+  std::string text;
+  for (int32_t i = 0; i < 1000; ++i) {
+    text += "2024-01-01 level=INFO module=table msg=flush block id=" +
+            std::to_string(i) + "\n";
+  }
+  std::string compressed;
+  lz::Compress(text.data(), text.size(), &compressed);
+  EXPECT_LT(compressed.size() * 3, text.size());
+}
+TEST(lz_compress_Test, Corruption) {
+  std::string text;
+  for (int32_t i = 0; i < 100; ++i) {
+    text += "corekv" + std::to_string(i % 7);
+  }
+  std::string compressed;
+  lz::Compress(text.data(), text.size(), &compressed);
+  std::string output;
+  // 截断的数据不能解压成功
+  for (size_t len = 0; len + 1 < compressed.size(); ++len) {
+    EXPECT_FALSE(lz::Uncompress(compressed.data(), len, &output));
+  }
+  // 偏移超出已解压的数据
+  std::string bad = compressed;
+  bad[1] = 0x04;
+  bad[2] = 'a';
+  bad[3] = static_cast<char>(0xff);
+  bad[4] = static_cast<char>(0xff);
+  EXPECT_FALSE(lz::Uncompress(bad.data(), bad.size(), &output));
+}
+TEST(lz_compress_Test, Dictionary) {
+  // 小block中重复的字段名需要依靠字典才能压缩
+  std::vector<std::string> blocks;
+  for (int32_t b = 0; b < 64; ++b) {
+    std::string block;
+    block += "{\"timestamp\":\"2024-01-01T00:00:" + std::to_string(b) +
+             "\",\"service_name\":\"storage-engine\",\"severity\":\"INFO\","
+             "\"request_id\":" + std::to_string(b * 7919) + "}";
+    blocks.push_back(block);
+  }
+  std::vector<std::string_view> samples(blocks.begin(), blocks.end());
+  std::string dict_data = lz::TrainDictionary(samples, 1024);
+  ASSERT_FALSE(dict_data.empty());
+  EXPECT_LE(dict_data.size(), 1024u);
+  lz::Dictionary dict(dict_data);
+  size_t plain_size = 0, dict_size = 0;
+  for (const auto& block : blocks) {
+    std::string plain, with_dict, output;
+    lz::Compress(block.data(), block.size(), &plain);
+    lz::Compress(&dict, block.data(), block.size(), &with_dict);
+    plain_size += plain.size();
+    dict_size += with_dict.size();
+    ASSERT_TRUE(lz::Uncompress(dict.Data(), with_dict.data(), with_dict.size(),
+                               &output));
+    EXPECT_EQ(output, block);
+    // 没有字典无法解压
+    EXPECT_FALSE(lz::Uncompress(with_dict.data(), with_dict.size(), &output) &&
+                 output == block);
+  }
+  EXPECT_LT(dict_size * 2, plain_size);
+}
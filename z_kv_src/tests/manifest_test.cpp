@@ -1,13 +1,18 @@
 #include "manifest/manifest.h"
 
 #include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/resource.h>
 
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "file/file.h"
 #include "logger/log.h"
 #include "manifest/manifest_change_edit.h"
+#include "utils/codec.h"
 
 using namespace std;
 using namespace z_kv;
@@ -19,4 +24,288 @@ TEST(manifestTest, Insert) {
   ManifestChangeEdit manifest_change_edit;
   ManifestHandler manifest_handler("./");
   manifest_handler.AddTableMeta(1, 1111);
-}
\ No newline at end of file
+}
+TEST(manifestTest, TableMeta) {
+  std::vector<ManifestChanage> manifest_changes;
+  // L1层的三个sst，key范围互不重叠
+  const vector<vector<string>> kRanges = {
+      {"corekv0", "corekv2"}, {"corekv3", "corekv5"}, {"corekv7", "corekv9"}};
+  for (uint64_t index = 0; index < kRanges.size(); ++index) {
+    ManifestChanage manifest_change;
+    manifest_change.id = 100 + index;
+    manifest_change.level = 1;
+    manifest_change.file_size = 4096 * (index + 1);
+    manifest_change.entry_num = 10;
+    manifest_change.smallest_seq = index * 10;
+    manifest_change.largest_seq = index * 10 + 9;
+    manifest_change.smallest_key = kRanges[index][0];
+    manifest_change.largest_key = kRanges[index][1];
+    manifest_changes.emplace_back(manifest_change);
+  }
+  std::string output;
+  ManifestChangeEdit encoder;
+  encoder.EncodeTo(manifest_changes, &output);
+
+  ManifestChangeEdit decoder;
+  decoder.DecodeTo(output);
+  Manifest manifest;
+  decoder.ApplyChangeSet(manifest);
+  ASSERT_EQ(manifest.table_levels_map.size(), 3);
+  const auto& table_meta = manifest.table_levels_map[101];
+  EXPECT_EQ(table_meta.file_size, 8192);
+  EXPECT_EQ(table_meta.smallest_seq, 10);
+  EXPECT_EQ(table_meta.largest_seq, 19);
+  EXPECT_EQ(table_meta.smallest_key, "corekv3");
+  EXPECT_EQ(table_meta.largest_key, "corekv5");
+
+  uint64_t sst_id = 0;
+  EXPECT_TRUE(manifest.FindTable(1, "corekv4", &sst_id));
+  EXPECT_EQ(sst_id, 101);
+  EXPECT_TRUE(manifest.FindTable(1, "corekv9", &sst_id));
+  EXPECT_EQ(sst_id, 102);
+  EXPECT_FALSE(manifest.FindTable(1, "corekv6", &sst_id));
+  EXPECT_FALSE(manifest.FindTable(1, "corekva", &sst_id));
+
+  std::vector<uint64_t> sst_ids;
+  manifest.GetOverlappingTables(1, "corekv1", "corekv4", &sst_ids);
+  EXPECT_EQ(sst_ids, std::vector<uint64_t>({100, 101}));
+
+  // 删除之后就查不到了
+  ManifestChanage delete_change;
+  delete_change.id = 101;
+  delete_change.level = 1;
+  delete_change.manifest_change_type = ManifestChanageOpType::kDelete;
+  output.clear();
+  encoder.EncodeTo({delete_change}, &output);
+  ManifestChangeEdit delete_decoder;
+  delete_decoder.DecodeTo(output);
+  delete_decoder.ApplyChangeSet(manifest);
+  EXPECT_FALSE(manifest.FindTable(1, "corekv4", &sst_id));
+  EXPECT_EQ(manifest.deletions, 1);
+}
+
+TEST(manifestTest, GroupCommit) {
+  static const std::string kDBPath = "./manifest_test_db";
+  FileTool::RemoveFile(kDBPath + "/MANIFEST");
+  static constexpr int32_t kThreadNum = 8;
+  static constexpr int32_t kTableNumPerThread = 50;
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    std::vector<std::thread> threads;
+    for (int32_t t = 0; t < kThreadNum; ++t) {
+      threads.emplace_back([&manifest_handler, t]() {
+        for (int32_t index = 0; index < kTableNumPerThread; ++index) {
+          TableManifest table_meta;
+          table_meta.file_size = 1024;
+          table_meta.smallest_key = "key" + std::to_string(t);
+          table_meta.largest_key = "key" + std::to_string(t) + "z";
+          manifest_handler.AddTableMeta(t % 3, t * 1000 + index, table_meta);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(manifest_handler.GetManifest().table_levels_map.size(),
+              kThreadNum * kTableNumPerThread);
+  }
+  // 重新打开，所有的edit都能恢复出来
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    EXPECT_EQ(manifest_handler.GetManifest().table_levels_map.size(),
+              kThreadNum * kTableNumPerThread);
+    // rewrite之后manifest中只保留当前版本
+    ASSERT_TRUE(manifest_handler.ReWrite());
+    manifest_handler.AddTableMeta(1, 999999);
+  }
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    const auto& manifest = manifest_handler.GetManifest();
+    EXPECT_EQ(manifest.table_levels_map.size(),
+              kThreadNum * kTableNumPerThread + 1);
+    EXPECT_EQ(manifest.table_levels_map.at(5003).smallest_key, "key5");
+  }
+}
+
+TEST(manifestTest, SnapshotAndTornTail) {
+  static const std::string kDBPath = "./manifest_snapshot_db";
+  FileTool::RemoveFile(kDBPath + "/MANIFEST");
+  FileTool::RemoveFile(kDBPath + "/SNAPSHOTMANIFEST");
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    for (int32_t index = 0; index < 100; ++index) {
+      manifest_handler.AddTableMeta(1, index);
+    }
+    // 生成快照之后增量日志被清空，文件被复用，关闭时才截断
+    const uint64_t log_size = FileTool::GetFileSize(kDBPath + "/MANIFEST");
+    ASSERT_TRUE(manifest_handler.ReWrite());
+    EXPECT_EQ(FileTool::GetFileSize(kDBPath + "/MANIFEST"), log_size);
+    manifest_handler.AddTableMeta(2, 1000);
+    manifest_handler.AddTableMeta(2, 1001);
+  }
+  EXPECT_LT(FileTool::GetFileSize(kDBPath + "/MANIFEST"), 200);
+  // 模拟写到一半崩溃，尾部残留半条record
+  const uint64_t log_size = FileTool::GetFileSize(kDBPath + "/MANIFEST");
+  {
+    FileWriter file_writer(kDBPath + "/MANIFEST", true);
+    // header完整，length(255)超出了文件末尾
+    const char kTornBytes[] = "\x12\x34\x56\x78\xff\x00\x00\x00" "abc";
+    const std::string kTornRecord(kTornBytes, sizeof(kTornBytes) - 1);
+    ASSERT_EQ(kTornRecord.size(), 11);
+    file_writer.Append(kTornRecord.data(), kTornRecord.size());
+    file_writer.Close();
+  }
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    EXPECT_EQ(manifest_handler.GetManifest().table_levels_map.size(), 102);
+    EXPECT_EQ(FileTool::GetFileSize(kDBPath + "/MANIFEST"), log_size);
+    manifest_handler.AddTableMeta(2, 1002);
+  }
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    const auto& manifest = manifest_handler.GetManifest();
+    EXPECT_EQ(manifest.table_levels_map.size(), 103);
+    EXPECT_EQ(manifest.level_tables_map[2].size(), 3);
+  }
+}
+// 复用的增量日志在没有关闭(崩溃)时尾部残留着旧的record
+TEST(manifestTest, RecycledLogStaleTail) {
+  static const std::string kDBPath = "./manifest_recycle_db";
+  const std::string manifest_name = kDBPath + "/MANIFEST";
+  FileTool::RemoveFile(manifest_name);
+  FileTool::RemoveFile(kDBPath + "/SNAPSHOTMANIFEST");
+  std::string crashed_content;
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    for (int32_t index = 0; index < 100; ++index) {
+      manifest_handler.AddTableMeta(1, index);
+    }
+    ASSERT_TRUE(manifest_handler.ReWrite());
+    manifest_handler.AddTableMeta(2, 1000);
+    // 每条record都已经Sync，保存此时的文件内容模拟崩溃
+    FileReader file_reader(manifest_name);
+    crashed_content.resize(FileTool::GetFileSize(manifest_name));
+    ASSERT_EQ(file_reader.Read(0, crashed_content.size(), &crashed_content),
+              Status::kSuccess);
+  }
+  {
+    FileWriter file_writer(manifest_name);
+    file_writer.Append(crashed_content.data(), crashed_content.size());
+    file_writer.Close();
+  }
+  for (int32_t round = 0; round < 2; ++round) {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    const auto& manifest = manifest_handler.GetManifest();
+    EXPECT_EQ(manifest.table_levels_map.size(), 101 + round);
+    EXPECT_EQ(manifest.level_tables_map.at(1).size(), 100);
+    EXPECT_EQ(manifest.level_tables_map.at(2).size(), 1 + round);
+    if (round == 0) {
+      manifest_handler.AddTableMeta(2, 1001);
+    }
+  }
+}
+// 写入失败时日志尾部残留的半条record被截断，之后的写入在重放时不会丢失
+TEST(manifestTest, FailedAppendIsTruncated) {
+  static const std::string kDBPath = "./manifest_failed_append_db";
+  const std::string manifest_name = kDBPath + "/MANIFEST";
+  FileTool::RemoveFile(manifest_name);
+  FileTool::RemoveFile(kDBPath + "/SNAPSHOTMANIFEST");
+  // 超过文件大小限制时write只写入一部分，之后返回EFBIG
+  signal(SIGXFSZ, SIG_IGN);
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    for (int32_t index = 0; index < 10; ++index) {
+      ASSERT_TRUE(manifest_handler.AddTableMeta(1, index));
+    }
+    struct rlimit old_limit;
+    ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &old_limit), 0);
+    struct rlimit limit = old_limit;
+    limit.rlim_cur = FileTool::GetFileSize(manifest_name) + 8;
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+    EXPECT_FALSE(manifest_handler.AddTableMeta(1, 100));
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &old_limit), 0);
+    EXPECT_TRUE(manifest_handler.AddTableMeta(1, 101));
+    EXPECT_TRUE(manifest_handler.AddTableMeta(1, 102));
+  }
+  ManifestHandler manifest_handler(kDBPath);
+  ASSERT_TRUE(manifest_handler.OpenManifestFile());
+  const auto& manifest = manifest_handler.GetManifest();
+  EXPECT_EQ(manifest.table_levels_map.size(), 12);
+  EXPECT_EQ(manifest.table_levels_map.count(100), 0);
+  EXPECT_EQ(manifest.table_levels_map.count(101), 1);
+  EXPECT_EQ(manifest.table_levels_map.count(102), 1);
+}
+// 旧版本的manifest没有文件头，打开失败而不是当作损坏的日志截断
+TEST(manifestTest, LegacyManifestIsRejected) {
+  static const std::string kDBPath = "./manifest_legacy_db";
+  const std::string manifest_name = kDBPath + "/MANIFEST";
+  FileTool::RemoveFile(manifest_name);
+  FileTool::RemoveFile(kDBPath + "/SNAPSHOTMANIFEST");
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+  }
+  std::vector<ManifestChanage> manifest_changes(1);
+  manifest_changes[0].id = 1;
+  manifest_changes[0].level = 1;
+  ManifestChangeEdit manifest_change_edit;
+  std::string legacy_content;
+  manifest_change_edit.EncodeTo(manifest_changes, &legacy_content);
+  {
+    FileWriter file_writer(manifest_name);
+    file_writer.Append(legacy_content.data(), legacy_content.size());
+    file_writer.Close();
+  }
+  ManifestHandler manifest_handler(kDBPath);
+  EXPECT_FALSE(manifest_handler.OpenManifestFile());
+  EXPECT_EQ(FileTool::GetFileSize(manifest_name), legacy_content.size());
+}
+// 日志中间的record校验失败时打开失败，最后一条record校验失败时当作尾部丢弃
+TEST(manifestTest, CorruptedRecord) {
+  static const std::string kDBPath = "./manifest_corrupted_db";
+  const std::string manifest_name = kDBPath + "/MANIFEST";
+  FileTool::RemoveFile(manifest_name);
+  FileTool::RemoveFile(kDBPath + "/SNAPSHOTMANIFEST");
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    ASSERT_TRUE(manifest_handler.OpenManifestFile());
+    for (int32_t index = 0; index < 3; ++index) {
+      ASSERT_TRUE(manifest_handler.AddTableMeta(1, index));
+    }
+  }
+  std::string content;
+  content.resize(FileTool::GetFileSize(manifest_name));
+  {
+    FileReader file_reader(manifest_name);
+    ASSERT_EQ(file_reader.Read(0, content.size(), &content),
+              Status::kSuccess);
+  }
+  auto write_with_flipped_byte = [&](uint64_t offset) {
+    std::string corrupted = content;
+    corrupted[offset] ^= 0x1;
+    FileWriter file_writer(manifest_name);
+    file_writer.Append(corrupted.data(), corrupted.size());
+    file_writer.Close();
+  };
+  // 第一条record的最后一个字节
+  const uint32_t length = util::DecodeFixed32(content.data() + 12);
+  write_with_flipped_byte(16 + length - 1);
+  {
+    ManifestHandler manifest_handler(kDBPath);
+    EXPECT_FALSE(manifest_handler.OpenManifestFile());
+    EXPECT_EQ(FileTool::GetFileSize(manifest_name), content.size());
+  }
+  write_with_flipped_byte(content.size() - 1);
+  ManifestHandler manifest_handler(kDBPath);
+  ASSERT_TRUE(manifest_handler.OpenManifestFile());
+  EXPECT_EQ(manifest_handler.GetManifest().table_levels_map.size(), 2);
+}
@@ -1,18 +1,41 @@
 #include "table/table_builder.h"
 
+#include <fcntl.h>
 #include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <chrono>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <vector>
 #include "db/comparator.h"
 #include "file/file.h"
+#include "file/file_name.h"
 #include "filter/bloomfilter.h"
+#include "table/block_checksum.h"
 #include "table/table.h"
+#include "table/table_cache.h"
+#include "table/table_options.h"
 #include "logger/log.h"
+#include "utils/codec.h"
+#include "utils/thread_pool.h"
 
 using namespace std;
 using namespace z_kv;
+// 文件系统不支持fallocate时跳过预分配空间的检查
+static bool FallocateSupported(const string& path) {
+  const int fd = ::open(path.c_str(), O_CREAT | O_WRONLY, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  const bool supported = fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, 4096) == 0;
+  ::close(fd);
+  ::unlink(path.c_str());
+  return supported;
+}
 static const vector<string> kTestKeys = {"corekv", "corekv1", "corekv2","corekv3","corekv4","corekv7"};
 TEST(table_builder_Test, Add) {
   z_kv::LogConfig log_config;
@@ -36,4 +59,642 @@ TEST(table_builder_Test, Add) {
   FileReader file_reader(st);
   Table tab(&options, &file_reader);
   tab.Open(FileTool::GetFileSize(st));
-}
\ No newline at end of file
+}
+TEST(table_builder_Test, LazyOpen) {
+  static const std::string st = "lazy_open.sst";
+  Options options;
+  options.filter_policy = std::make_unique<BloomFilter>(30);
+  options.comparator = std::make_unique<ByteComparator>();
+  FileWriter* file_handler = new FileWriter(st);
+  TableBuilder* tb = new TableBuilder(options, file_handler);
+  for (const auto& item : kTestKeys) {
+    tb->Add(item, item);
+  }
+  tb->Finish();
+  delete tb;
+  delete file_handler;
+
+  // Open不会读取任何数据，元数据由后台线程池预热
+  static constexpr int32_t kTableNum = 16;
+  FileReader file_reader(st);
+  std::vector<std::unique_ptr<Table>> tables;
+  for (int32_t index = 0; index < kTableNum; ++index) {
+    tables.emplace_back(std::make_unique<Table>(&options, &file_reader));
+    EXPECT_EQ(tables.back()->Open(FileTool::GetFileSize(st)),
+              Status::kSuccess);
+  }
+  {
+    ThreadPool thread_pool(4);
+    for (auto& table : tables) {
+      table->ScheduleWarmUp(&thread_pool);
+    }
+    thread_pool.WaitForIdle();
+  }
+  for (auto& table : tables) {
+    EXPECT_EQ(table->WarmUp(), Status::kSuccess);
+    for (const auto& item : kTestKeys) {
+      EXPECT_TRUE(table->KeyMayMatch(item));
+    }
+  }
+}
+// 通过index逐个block读取并解压，返回读到的所有kv
+static std::vector<std::pair<std::string, std::string>> ReadAllEntries(
+    const std::string& path) {
+  std::vector<std::pair<std::string, std::string>> entries;
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  const uint64_t file_size = FileTool::GetFileSize(path);
+  FileReader file_reader(path);
+  Table table(&options, &file_reader);
+  EXPECT_EQ(table.Open(file_size), Status::kSuccess);
+  EXPECT_EQ(table.WarmUp(), Status::kSuccess);
+  Iterator* iter = table.NewIterator(ReadOptions());
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    entries.emplace_back(std::string(iter->key()), iter->value());
+  }
+  EXPECT_EQ(iter->status(), Status::kSuccess);
+  delete iter;
+  return entries;
+}
+// 测试sst中的第index个key
+static std::string TestKey(int32_t index) {
+  char key[32];
+  snprintf(key, sizeof(key), "key%06d", index);
+  return key;
+}
+// 按options创建输出文件，写入n条TestKey(index) -> value_fn(index)
+static void BuildTestTable(
+    const Options& options, const std::string& path, int32_t n,
+    const std::function<std::string(int32_t)>& value_fn) {
+  auto file_handler = TableBuilder::NewFileWriter(options, path);
+  TableBuilder tb(options, file_handler.get());
+  for (int32_t index = 0; index < n; ++index) {
+    tb.Add(TestKey(index), value_fn(index));
+  }
+  tb.Finish();
+  EXPECT_TRUE(tb.Success());
+  EXPECT_EQ(FileTool::GetFileSize(path), tb.GetFileSize());
+}
+static std::string PlainValue(int32_t index) {
+  return "value_" + TestKey(index);
+}
+TEST(table_builder_Test, Compression) {
+  static const std::string raw_st = "raw.sst";
+  static const std::string lz_st = "lz.sst";
+  static constexpr int32_t kEntryNum = 2000;
+  auto value_of = [](int32_t index) {
+    return "level=INFO module=table msg=flush " + TestKey(index);
+  };
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.block_compress_type = kNonCompress;
+  BuildTestTable(options, raw_st, kEntryNum, value_of);
+  options.block_compress_type = kLZCompression;
+  BuildTestTable(options, lz_st, kEntryNum, value_of);
+  EXPECT_LT(FileTool::GetFileSize(lz_st) * 2, FileTool::GetFileSize(raw_st));
+
+  // 逐个block读取并解压，检查所有数据
+  const auto entries = ReadAllEntries(lz_st);
+  ASSERT_EQ(entries.size(), kEntryNum);
+  for (int32_t index = 0; index < kEntryNum; ++index) {
+    EXPECT_EQ(entries[index].first, TestKey(index));
+    EXPECT_EQ(entries[index].second, value_of(index));
+  }
+}
+TEST(table_builder_Test, DictCompression) {
+  static const std::string lz_st = "lz_nodict.sst";
+  static const std::string dict_st = "lz_dict.sst";
+  static constexpr int32_t kEntryNum = 3000;
+  auto value_of = [](int32_t index) {
+    return "{\"ts\":" + std::to_string(1700000000 + index * 37) +
+           ",\"service_name\":\"storage-engine\",\"severity\":\"" +
+           (index % 3 ? "INFO" : "WARN") + "\",\"trace_id\":\"" +
+           std::to_string(index * 7919 % 100003) + "\"}";
+  };
+  Options options;
+  options.block_size = 1024;
+  options.block_compress_type = kLZCompression;
+  options.compression_dict_sample_size = 32 * 1024;
+  options.filter_policy = std::make_unique<BloomFilter>(10);
+  options.comparator = std::make_unique<ByteComparator>();
+  options.compression_dict_size = 0;
+  BuildTestTable(options, lz_st, kEntryNum, value_of);
+  options.compression_dict_size = 4096;
+  BuildTestTable(options, dict_st, kEntryNum, value_of);
+  EXPECT_LT(FileTool::GetFileSize(dict_st), FileTool::GetFileSize(lz_st));
+
+  const auto entries = ReadAllEntries(dict_st);
+  ASSERT_EQ(entries.size(), kEntryNum);
+  for (int32_t index = 0; index < kEntryNum; ++index) {
+    EXPECT_EQ(entries[index].first, TestKey(index));
+    EXPECT_EQ(entries[index].second, value_of(index));
+  }
+}
+TEST(table_builder_Test, ParallelCompression) {
+  static const std::string serial_st = "serial.sst";
+  static const std::string parallel_st = "parallel.sst";
+  static constexpr int32_t kEntryNum = 5000;
+  auto pool = std::make_shared<ThreadPool>(4);
+  auto value_of = [](int32_t index) {
+    return "value=" + std::to_string(index * 31) +
+           " module=table msg=compact " + TestKey(index);
+  };
+  Options options;
+  options.block_size = 1024;
+  options.block_compress_type = kLZCompression;
+  options.compression_dict_sample_size = 16 * 1024;
+  options.compress_pending_blocks = 4;
+  options.comparator = std::make_unique<ByteComparator>();
+  auto read_file = [](const std::string& path) {
+    const uint64_t size = FileTool::GetFileSize(path);
+    std::string data(size, '\0');
+    FileReader reader(path);
+    reader.Read(0, size, &data);
+    return data;
+  };
+  for (uint32_t dict_size : {0u, 2048u}) {
+    options.compression_dict_size = dict_size;
+    options.compress_pool = nullptr;
+    BuildTestTable(options, serial_st, kEntryNum, value_of);
+    options.compress_pool = pool;
+    BuildTestTable(options, parallel_st, kEntryNum, value_of);
+    // 并行压缩和串行压缩生成的文件完全一致
+    EXPECT_EQ(read_file(serial_st), read_file(parallel_st));
+    const auto entries = ReadAllEntries(parallel_st);
+    ASSERT_EQ(entries.size(), kEntryNum);
+    for (int32_t index = 0; index < kEntryNum; ++index) {
+      EXPECT_EQ(entries[index].first, TestKey(index));
+    }
+  }
+}
+TEST(table_builder_Test, PerLevelOptions) {
+  Options options;
+  options.block_compress_type = kLZCompression;
+  options.compression_dict_size = 4096;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.compression_per_level = {kNonCompress, kNonCompress, kLZCompression};
+  options.compression_dict_per_level = {false, false, false, true};
+  options.block_size_per_level = {4096, 4096, 16384};
+  options.bloom_bits_per_key_per_level = {10, 10, 10, 10, 10, 10, 0};
+
+  const Options l0 = options.ForLevel(0);
+  EXPECT_EQ(l0.block_compress_type, kNonCompress);
+  EXPECT_EQ(l0.compression_dict_size, 0u);
+  EXPECT_EQ(l0.block_size, 4096u);
+  EXPECT_NE(l0.filter_policy, nullptr);
+  const Options l3 = options.ForLevel(3);
+  EXPECT_EQ(l3.block_compress_type, kLZCompression);
+  EXPECT_EQ(l3.compression_dict_size, 4096u);
+  EXPECT_EQ(l3.block_size, 16384u);
+  // 超过vector长度的层使用最后一个设置
+  const Options l6 = options.ForLevel(6);
+  EXPECT_EQ(l6.block_compress_type, kLZCompression);
+  EXPECT_EQ(l6.filter_policy, nullptr);
+
+  static const std::string kDBPath = "per_level_db";
+  const std::string l0_st = FileName::FileNameSSTable(kDBPath, 1);
+  const std::string l6_st = FileName::FileNameSSTable(kDBPath, 7);
+  static constexpr int32_t kEntryNum = 2000;
+  auto value_of = [](int32_t index) {
+    return "level=INFO module=table msg=flush " + TestKey(index);
+  };
+  BuildTestTable(l0, l0_st, kEntryNum, value_of);
+  BuildTestTable(l6, l6_st, kEntryNum, value_of);
+  EXPECT_LT(FileTool::GetFileSize(l6_st) * 2, FileTool::GetFileSize(l0_st));
+  EXPECT_EQ(ReadAllEntries(l0_st).size(), kEntryNum);
+  EXPECT_EQ(ReadAllEntries(l6_st).size(), kEntryNum);
+
+  // 通过table cache用全局的options读取，
+  // L0带过滤器，不存在的key大概率被过滤
+  TableCache table_cache(kDBPath, &options, 4);
+  TableCache::Handle* handle = nullptr;
+  ASSERT_EQ(table_cache.FindTable(1, 0, &handle), Status::kSuccess);
+  Table* l0_table = table_cache.GetTable(handle);
+  EXPECT_TRUE(l0_table->KeyMayMatch("key000001"));
+  int32_t false_positive = 0;
+  for (int32_t index = 0; index < 1000; ++index) {
+    false_positive += l0_table->KeyMayMatch("missing" + std::to_string(index));
+  }
+  EXPECT_LT(false_positive, 50);
+  table_cache.Release(handle);
+  // L6没有过滤器，不能过滤任何key
+  ASSERT_EQ(table_cache.FindTable(7, 0, &handle), Status::kSuccess);
+  EXPECT_TRUE(table_cache.GetTable(handle)->KeyMayMatch("missing"));
+  std::string value;
+  EXPECT_EQ(table_cache.GetTable(handle)->Get(ReadOptions(), "key000123",
+                                              &value),
+            Status::kSuccess);
+  EXPECT_EQ(value, "level=INFO module=table msg=flush key000123");
+  table_cache.Release(handle);
+}
+TEST(table_builder_Test, PartitionedIndex) {
+  static const std::string st = "partitioned.sst";
+  static constexpr int32_t kEntryNum = 20000;
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.filter_policy = std::make_shared<BloomFilter>(10);
+  options.partition_index_and_filters = true;
+  options.metadata_block_size = 256;
+  BuildTestTable(options, st, kEntryNum, PlainValue);
+  const auto entries = ReadAllEntries(st);
+  ASSERT_EQ(entries.size(), kEntryNum);
+  for (int32_t index = 0; index < kEntryNum; ++index) {
+    EXPECT_EQ(entries[index].first, TestKey(index));
+  }
+
+  // 分区通过block cache加载
+  ShardCache<uint64_t, DataBlock> block_cache(64);
+  options.block_cache = &block_cache;
+  FileReader file_reader(st);
+  Table table(&options, &file_reader, 1);
+  ASSERT_EQ(table.Open(FileTool::GetFileSize(st)), Status::kSuccess);
+  Iterator* iter = table.NewIterator(ReadOptions());
+  iter->Seek("key012345");
+  ASSERT_TRUE(iter->Valid());
+  EXPECT_EQ(iter->key(), "key012345");
+  EXPECT_EQ(iter->value(), "value_key012345");
+  iter->Seek("key0199999");
+  EXPECT_FALSE(iter->Valid());
+  delete iter;
+  for (int32_t index = 0; index < kEntryNum; ++index) {
+    EXPECT_TRUE(table.KeyMayMatch(TestKey(index)));
+  }
+  int32_t false_positive = 0;
+  for (int32_t index = 0; index < 1000; ++index) {
+    false_positive += table.KeyMayMatch(TestKey(index * 7) + ".x");
+  }
+  EXPECT_LT(false_positive, 50);
+  // 比sst中所有key都大，不需要加载任何分区
+  EXPECT_FALSE(table.KeyMayMatch("zzz"));
+  std::string value;
+  EXPECT_EQ(table.Get(ReadOptions(), "key000777", &value), Status::kSuccess);
+  EXPECT_EQ(value, "value_key000777");
+  EXPECT_EQ(table.Get(ReadOptions(), "key000777.x", &value), Status::kNotFound);
+}
+TEST(table_builder_Test, PerBlockFilter) {
+  static const std::string st = "block_filter.sst";
+  static constexpr int32_t kEntryNum = 20000;
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.filter_policy = std::make_shared<BloomFilter>(10);
+  BuildTestTable(options, st, kEntryNum, PlainValue);
+  FileReader file_reader(st);
+  Table table(&options, &file_reader);
+  ASSERT_EQ(table.Open(FileTool::GetFileSize(st)), Status::kSuccess);
+  std::string value;
+  for (int32_t index = 0; index < kEntryNum; ++index) {
+    const std::string key = TestKey(index);
+    EXPECT_TRUE(table.KeyMayMatch(key));
+    ASSERT_EQ(table.Get(ReadOptions(), key, &value), Status::kSuccess);
+    EXPECT_EQ(value, PlainValue(index));
+  }
+  // 每个block只有自己的key，不存在的key大概率被对应block的filter过滤
+  int32_t false_positive = 0;
+  for (int32_t index = 0; index < 1000; ++index) {
+    const std::string key = TestKey(index * 7) + ".x";
+    false_positive += table.KeyMayMatch(key);
+    EXPECT_EQ(table.Get(ReadOptions(), key, &value), Status::kNotFound);
+  }
+  EXPECT_LT(false_positive, 50);
+  EXPECT_FALSE(table.KeyMayMatch("zzz"));
+  EXPECT_EQ(table.Get(ReadOptions(), "zzz", &value), Status::kNotFound);
+}
+TEST(table_builder_Test, XorFilterLevel) {
+  static const std::string st = "xor_filter.sst";
+  static constexpr int32_t kEntryNum = 20000;
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.filter_type_per_level = {kBloomFilterPolicy, kBloomFilterPolicy,
+                                   kXorFilterPolicy};
+  const Options l0 = options.ForLevel(0);
+  EXPECT_STREQ(l0.filter_policy->Name(), "general_bloomfilter");
+  const Options l6 = options.ForLevel(6);
+  ASSERT_NE(l6.filter_policy, nullptr);
+  EXPECT_STREQ(l6.filter_policy->Name(), "xor8_filter");
+  BuildTestTable(l6, st, kEntryNum, PlainValue);
+  FileReader file_reader(st);
+  Table table(&l6, &file_reader);
+  ASSERT_EQ(table.Open(FileTool::GetFileSize(st)), Status::kSuccess);
+  std::string value;
+  for (int32_t index = 0; index < kEntryNum; ++index) {
+    ASSERT_TRUE(table.KeyMayMatch(TestKey(index)));
+  }
+  int32_t false_positive = 0;
+  for (int32_t index = 0; index < 1000; ++index) {
+    const std::string key = TestKey(index * 7) + ".x";
+    false_positive += table.KeyMayMatch(key);
+    EXPECT_EQ(table.Get(ReadOptions(), key, &value), Status::kNotFound);
+  }
+  EXPECT_LT(false_positive, 20);
+}
+TEST(table_builder_Test, FilterHashDedup) {
+  Options options;
+  options.filter_policy = std::make_shared<BloomFilter>(10);
+  FilterBlockBuilder builder(options);
+  builder.Add("corekv");
+  builder.Add("corekv");
+  builder.Add("corekv1");
+  builder.Add("corekv1");
+  EXPECT_EQ(builder.KeyNum(), 2u);
+  EXPECT_EQ(builder.FinishBlock(), 2u);
+  // 下一个block中的相同key需要单独记录
+  builder.Add("corekv1");
+  EXPECT_EQ(builder.KeyNum(), 3u);
+  std::string filter;
+  builder.FinishPartition(builder.FinishBlock(), &filter);
+  EXPECT_EQ(builder.KeyNum(), 3u);
+  EXPECT_TRUE(builder.MayMatch("corekv", filter));
+  EXPECT_TRUE(builder.MayMatch("corekv1", filter));
+}
+// footer中记录的校验算法决定读取时如何校验block
+TEST(table_builder_Test, ChecksumType) {
+  static const std::string st = "checksum.sst";
+  static constexpr int32_t kEntryNum = 2000;
+  for (const ChecksumType checksum_type :
+       {kNoChecksum, kCRC32cChecksum, kHash64Checksum}) {
+    Options options;
+    options.comparator = std::make_unique<ByteComparator>();
+    options.checksum_type = checksum_type;
+    BuildTestTable(options, st, kEntryNum, TestKey);
+    // 读取端使用默认的Options，校验算法只来自footer
+    EXPECT_EQ(ReadAllEntries(st).size(), kEntryNum);
+    // 修改第一个data block中的一个字节
+    {
+      std::fstream file(st, std::ios::in | std::ios::out | std::ios::binary);
+      file.seekp(10);
+      file.put('#');
+    }
+    FileReader file_reader(st);
+    Table table(&options, &file_reader);
+    ASSERT_EQ(table.Open(FileTool::GetFileSize(st)), Status::kSuccess);
+    std::string value;
+    const DBStatus status = table.Get(ReadOptions(), "key000000", &value);
+    // 不校验时读到的是被修改过的数据
+    if (checksum_type == kNoChecksum) {
+      EXPECT_NE(status, Status::kInvalidObject);
+    } else {
+      EXPECT_EQ(status, Status::kInvalidObject);
+    }
+  }
+}
+// 旧版本sst的40字节footer按crc32c校验
+TEST(table_builder_Test, LegacyFooter) {
+  static const std::string st = "legacy_footer.sst";
+  static constexpr int32_t kEntryNum = 2000;
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  BuildTestTable(options, st, kEntryNum, TestKey);
+  std::string contents;
+  {
+    std::ifstream file(st, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+  }
+  // 去掉新footer中的校验算法和保留字段，换成旧的magic
+  contents.resize(contents.size() - kEncodedLength + 32);
+  util::PutFixed32(&contents,
+                   static_cast<uint32_t>(kTableMagicNumber & 0xffffffffu));
+  util::PutFixed32(&contents, static_cast<uint32_t>(kTableMagicNumber >> 32));
+  {
+    std::ofstream file(st, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), contents.size());
+  }
+  EXPECT_EQ(ReadAllEntries(st).size(), kEntryNum);
+}
+// 每个block校验的开销：4KB的block分别用三种算法计算
+// 只输出吞吐不做检查，默认不运行，使用--gtest_also_run_disabled_tests手动运行
+TEST(table_builder_Test, DISABLED_ChecksumThroughput) {
+  static constexpr size_t kBlockSize = 4096;
+  std::string block;
+  for (size_t index = 0; index < kBlockSize; ++index) {
+    block.push_back(static_cast<char>(index * 131 + 7));
+  }
+  static constexpr size_t kRounds = (256u << 20) / kBlockSize;
+  for (const ChecksumType checksum_type :
+       {kNoChecksum, kCRC32cChecksum, kHash64Checksum}) {
+    uint32_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t index = 0; index < kRounds; ++index) {
+      sink += BlockChecksum(checksum_type, block.data(), block.size(),
+                            static_cast<char>(index & 1));
+    }
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    std::cout << "checksum_type=" << checksum_type
+              << " ns/block=" << seconds * 1e9 / kRounds
+              << " GB/s=" << kRounds * kBlockSize / seconds / 1e9 << " ("
+              << sink % 10 << ")" << std::endl;
+  }
+}
+// mmap模式：未压缩的block直接引用映射，不进入block cache；压缩的block解压后缓存
+TEST(table_builder_Test, MmapReads) {
+  static const std::string st = "mmap.sst";
+  static constexpr int32_t kEntryNum = 5000;
+  for (const BlockCompressType compress_type :
+       {kNonCompress, kLZCompression}) {
+    Options options;
+    options.comparator = std::make_unique<ByteComparator>();
+    options.filter_policy = std::make_shared<BloomFilter>(10);
+    options.block_compress_type = compress_type;
+    auto value_of = [](int32_t index) {
+      return std::string(64, 'a' + index % 26);
+    };
+    BuildTestTable(options, st, kEntryNum, value_of);
+    ShardCache<uint64_t, DataBlock> block_cache(64);
+    options.block_cache = &block_cache;
+    options.use_mmap_reads = true;
+    FileReader file_reader(st, options.use_mmap_reads);
+    ASSERT_TRUE(file_reader.IsMmap());
+    file_reader.Advise(FileReader::kRandom);
+    Table table(&options, &file_reader);
+    ASSERT_EQ(table.Open(FileTool::GetFileSize(st)), Status::kSuccess);
+    std::string value;
+    for (int32_t index = 0; index < kEntryNum; index += 7) {
+      ASSERT_EQ(table.Get(ReadOptions(), TestKey(index), &value),
+                Status::kSuccess);
+      EXPECT_EQ(value, value_of(index));
+    }
+    EXPECT_EQ(table.Get(ReadOptions(), "key000000.x", &value),
+              Status::kNotFound);
+    // 第一个data block的偏移为0
+    auto* handle = block_cache.Get(0);
+    EXPECT_EQ(handle != nullptr, compress_type != kNonCompress);
+    if (handle != nullptr) {
+      block_cache.Release(handle);
+    }
+    file_reader.Advise(FileReader::kSequential);
+    std::unique_ptr<Iterator> iter(table.NewIterator(ReadOptions()));
+    int32_t count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ++count;
+    }
+    EXPECT_EQ(iter->status(), Status::kSuccess);
+    EXPECT_EQ(count, kEntryNum);
+    // 不使用mmap时读到的数据相同
+    EXPECT_EQ(ReadAllEntries(st).size(), kEntryNum);
+  }
+}
+// 批量点查：io_uring和线程池两种方式的结果和逐个Get一致
+TEST(table_builder_Test, MultiGet) {
+  static const std::string st = "multi_get.sst";
+  static constexpr int32_t kEntryNum = 20000;
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.filter_policy = std::make_shared<BloomFilter>(10);
+  options.block_compress_type = kLZCompression;
+  BuildTestTable(options, st, kEntryNum, PlainValue);
+  // 存在和不存在的key交替出现
+  std::vector<std::string> key_storage;
+  for (int32_t index = 0; index < kEntryNum; index += 97) {
+    key_storage.emplace_back(TestKey(index));
+    key_storage.emplace_back(TestKey(index) + ".x");
+  }
+  key_storage.emplace_back("zzz");
+  const std::vector<std::string_view> keys(key_storage.begin(),
+                                           key_storage.end());
+  for (const bool io_uring : {true, false}) {
+    for (const bool use_cache : {false, true}) {
+      FileReader::EnableIoUring(io_uring);
+      ShardCache<uint64_t, DataBlock> block_cache(64);
+      options.block_cache = use_cache ? &block_cache : nullptr;
+      FileReader file_reader(st);
+      Table table(&options, &file_reader);
+      ASSERT_EQ(table.Open(FileTool::GetFileSize(st)), Status::kSuccess);
+      // 有cache时第二轮全部命中
+      for (int32_t round = 0; round < 2; ++round) {
+        std::vector<std::string> values;
+        std::vector<DBStatus> statuses;
+        table.MultiGet(ReadOptions(), keys, &values, &statuses);
+        ASSERT_EQ(statuses.size(), keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+          std::string value;
+          const DBStatus expected = table.Get(ReadOptions(), keys[i], &value);
+          EXPECT_EQ(statuses[i], expected) << keys[i];
+          if (expected == Status::kSuccess) {
+            EXPECT_EQ(values[i], value);
+          }
+        }
+      }
+    }
+  }
+  FileReader::EnableIoUring(true);
+  options.block_cache = nullptr;
+}
+// 一次提交的请求可以来自不同的文件，读越界时返回错误
+TEST(table_builder_Test, MultiRead) {
+  static const std::string st1 = "multi_read1.sst";
+  static const std::string st2 = "multi_read2.sst";
+  for (const auto& path : {st1, st2}) {
+    FileWriter writer(path);
+    for (int32_t index = 0; index < 4096; ++index) {
+      const std::string line = path + std::to_string(index) + "\n";
+      writer.Append(line.data(), line.size());
+    }
+    writer.Close();
+  }
+  FileReader reader1(st1);
+  FileReader reader2(st2);
+  for (const bool io_uring : {true, false}) {
+    FileReader::EnableIoUring(io_uring);
+    std::vector<std::string> results(8);
+    std::vector<ReadRequest> requests(results.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+      requests[i].reader = i % 2 ? &reader2 : &reader1;
+      requests[i].offset = i * 1000;
+      requests[i].len = 100;
+      requests[i].result = &results[i];
+    }
+    EXPECT_EQ(FileReader::MultiRead(requests.data(), requests.size()),
+              Status::kSuccess);
+    for (size_t i = 0; i < requests.size(); ++i) {
+      std::string expected(100, 0);
+      EXPECT_EQ(requests[i].reader->Read(requests[i].offset, 100, &expected),
+                Status::kSuccess);
+      EXPECT_EQ(results[i], expected);
+      EXPECT_EQ(requests[i].status, Status::kSuccess);
+    }
+    requests[3].offset = FileTool::GetFileSize(st2) - 10;
+    EXPECT_EQ(FileReader::MultiRead(requests.data(), requests.size()),
+              Status::kReadFileFailed);
+    EXPECT_EQ(requests[3].status, Status::kReadFileFailed);
+    EXPECT_EQ(requests[2].status, Status::kSuccess);
+  }
+  FileReader::EnableIoUring(true);
+}
+// flush/compaction使用direct io构建和读取sst
+TEST(table_builder_Test, DirectIo) {
+  static const std::string st = "direct_io.sst";
+  static constexpr int32_t kEntryNum = 20000;
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.filter_policy = std::make_shared<BloomFilter>(10);
+  options.use_direct_io_for_flush_and_compaction = true;
+  BuildTestTable(options, st, kEntryNum, PlainValue);
+  // 文件系统不支持O_DIRECT时退化为普通模式
+  const bool direct_io = FileReader(st, false, true).IsDirectIo();
+  // 带预读缓冲区(compaction_readahead_size)和不带预读缓冲区的输入文件
+  for (const uint32_t readahead_size : {0u, 2u * 1024 * 1024, 10000u}) {
+    options.compaction_readahead_size = readahead_size;
+    auto file_reader = TableCache::NewCompactionReader(options, st);
+    EXPECT_EQ(file_reader->IsDirectIo(), direct_io);
+    Table table(&options, file_reader.get());
+    ASSERT_EQ(table.Open(FileTool::GetFileSize(st)), Status::kSuccess);
+    std::unique_ptr<Iterator> iter(table.NewIterator(ReadOptions()));
+    int32_t count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ++count;
+    }
+    EXPECT_EQ(iter->status(), Status::kSuccess);
+    EXPECT_EQ(count, kEntryNum);
+  }
+  EXPECT_EQ(ReadAllEntries(st).size(), kEntryNum);
+}
+// 通过Options创建异步写的输出文件(多个写缓冲区和bytes_per_sync)
+TEST(table_builder_Test, AsyncFileWriter) {
+  static const std::string st = "async_writer.sst";
+  static constexpr int32_t kEntryNum = 20000;
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.filter_policy = std::make_shared<BloomFilter>(10);
+  for (const bool direct_io : {false, true}) {
+    options.use_direct_io_for_flush_and_compaction = direct_io;
+    options.table_write_buffer_num = 3;
+    options.bytes_per_sync = 64 * 1024;
+    EXPECT_TRUE(TableBuilder::NewFileWriter(options, st)->IsAsync());
+    BuildTestTable(options, st, kEntryNum, PlainValue);
+    const auto entries = ReadAllEntries(st);
+    ASSERT_EQ(entries.size(), kEntryNum);
+    EXPECT_EQ(entries[12345].first, "key012345");
+  }
+}
+// 输出文件按table_preallocate_size预分配，Finish之后释放没有用到的空间
+TEST(table_builder_Test, PreallocatedFileWriter) {
+  static const std::string st = "preallocated.sst";
+  // 数据量超过FileWriter的缓冲区，Finish之前已经有数据写到文件中
+  static constexpr int32_t kEntryNum = 10000;
+  static constexpr uint64_t kPreallocateSize = 1024 * 1024;
+  if (!FallocateSupported(st)) {
+    GTEST_SKIP() << "fallocate not supported";
+  }
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.table_preallocate_size = kPreallocateSize;
+  auto file_handler = TableBuilder::NewFileWriter(options, st);
+  TableBuilder tb(options, file_handler.get());
+  for (int32_t index = 0; index < kEntryNum; ++index) {
+    tb.Add(TestKey(index), PlainValue(index));
+  }
+  struct stat file_stat;
+  ASSERT_EQ(stat(st.c_str(), &file_stat), 0);
+  ASSERT_GT(file_stat.st_size, 0);
+  EXPECT_GE(static_cast<uint64_t>(file_stat.st_blocks) * 512,
+            kPreallocateSize);
+  tb.Finish();
+  EXPECT_TRUE(tb.Success());
+  ASSERT_EQ(stat(st.c_str(), &file_stat), 0);
+  EXPECT_EQ(static_cast<uint64_t>(file_stat.st_size), tb.GetFileSize());
+  EXPECT_LT(static_cast<uint64_t>(file_stat.st_blocks) * 512,
+            tb.GetFileSize() + 64 * 1024);
+  EXPECT_EQ(ReadAllEntries(st).size(), kEntryNum);
+}
@@ -0,0 +1,135 @@
+#include "table/table_cache.h"
+
+#include <dirent.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "db/comparator.h"
+#include "file/file.h"
+#include "file/file_name.h"
+#include "filter/bloomfilter.h"
+#include "logger/log.h"
+#include "table/table_builder.h"
+
+using namespace std;
+using namespace z_kv;
+static const vector<string> kTestKeys = {"corekv", "corekv1", "corekv2",
+                                         "corekv3", "corekv4", "corekv7"};
+static const std::string kDBPath = "table_cache_db";
+// 统计当前进程打开的文件句柄数
+static int32_t OpenFdNum() {
+  int32_t num = 0;
+  DIR* dir = opendir("/proc/self/fd");
+  if (!dir) {
+    return -1;
+  }
+  while (readdir(dir) != nullptr) {
+    ++num;
+  }
+  closedir(dir);
+  return num;
+}
+static void BuildTable(Options& options, uint64_t sst_id) {
+  // BloomFilter会缓存已生成的过滤器，每个sst使用一个新的
+  options.filter_policy = std::make_unique<BloomFilter>(30);
+  FileWriter file_handler(FileName::FileNameSSTable(kDBPath, sst_id));
+  TableBuilder tb(options, &file_handler);
+  for (const auto& item : kTestKeys) {
+    tb.Add(item, item);
+  }
+  tb.Finish();
+}
+TEST(table_cache_Test, BoundOpenFiles) {
+  static constexpr uint32_t kMaxOpenFiles = 4;
+  static constexpr uint64_t kTableNum = 32;
+  z_kv::LogConfig log_config;
+  log_config.log_type = z_kv::LogType::CONSOLE;
+  z_kv::Log::GetInstance()->InitLog(log_config);
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  for (uint64_t sst_id = 1; sst_id <= kTableNum; ++sst_id) {
+    BuildTable(options, sst_id);
+  }
+
+  const int32_t base_fd_num = OpenFdNum();
+  ASSERT_GT(base_fd_num, 0);
+  {
+    TableCache table_cache(kDBPath, &options, kMaxOpenFiles);
+    for (int32_t round = 0; round < 2; ++round) {
+      for (uint64_t sst_id = 1; sst_id <= kTableNum; ++sst_id) {
+        TableCache::Handle* handle = nullptr;
+        ASSERT_EQ(table_cache.FindTable(sst_id, 0, &handle), Status::kSuccess);
+        for (const auto& item : kTestKeys) {
+          EXPECT_TRUE(table_cache.GetTable(handle)->KeyMayMatch(item));
+        }
+        table_cache.Release(handle);
+        // 打开的句柄数不能超过上限
+        EXPECT_LE(OpenFdNum(), base_fd_num + (int32_t)kMaxOpenFiles);
+      }
+    }
+    // 被持有的table在Evict之后仍然可用，释放时才关闭文件
+    TableCache::Handle* handle = nullptr;
+    ASSERT_EQ(table_cache.FindTable(kTableNum, 0, &handle), Status::kSuccess);
+    table_cache.Evict(kTableNum);
+    EXPECT_TRUE(table_cache.GetTable(handle)->KeyMayMatch(kTestKeys[0]));
+    table_cache.Release(handle);
+
+    EXPECT_EQ(table_cache.FindTable(kTableNum + 1, 0, &handle),
+              Status::kNotFound);
+  }
+  // 缓存析构后所有句柄都已关闭
+  EXPECT_EQ(OpenFdNum(), base_fd_num);
+  for (uint64_t sst_id = 1; sst_id <= kTableNum; ++sst_id) {
+    FileTool::RemoveFile(FileName::FileNameSSTable(kDBPath, sst_id));
+  }
+  FileTool::RemoveDir(kDBPath);
+}
+// 按层选择的过滤器(blocked bloom/xor)通过table cache用全局Options读取时，
+// 按sst中记录的过滤器名字恢复，不存在的key要被过滤
+TEST(table_cache_Test, PerLevelFilter) {
+  z_kv::LogConfig log_config;
+  log_config.log_type = z_kv::LogType::CONSOLE;
+  z_kv::Log::GetInstance()->InitLog(log_config);
+  static constexpr int32_t kEntryNum = 5000;
+  Options options;
+  options.comparator = std::make_unique<ByteComparator>();
+  options.filter_type_per_level = {kBlockedBloomFilterPolicy,
+                                   kBlockedBloomFilterPolicy, kXorFilterPolicy};
+  EXPECT_EQ(options.filter_policy, nullptr);
+  for (const int32_t level : {0, 6}) {
+    FileWriter file_handler(FileName::FileNameSSTable(kDBPath, level + 1));
+    TableBuilder tb(options, &file_handler, level);
+    char key[32];
+    for (int32_t index = 0; index < kEntryNum; ++index) {
+      snprintf(key, sizeof(key), "key%06d", index);
+      tb.Add(key, key);
+    }
+    tb.Finish();
+  }
+  TableCache table_cache(kDBPath, &options, 4);
+  for (const uint64_t sst_id : {1, 7}) {
+    TableCache::Handle* handle = nullptr;
+    ASSERT_EQ(table_cache.FindTable(sst_id, 0, &handle), Status::kSuccess);
+    Table* table = table_cache.GetTable(handle);
+    char key[32];
+    for (int32_t index = 0; index < kEntryNum; ++index) {
+      snprintf(key, sizeof(key), "key%06d", index);
+      ASSERT_TRUE(table->KeyMayMatch(key));
+    }
+    int32_t false_positive = 0;
+    std::string value;
+    for (int32_t index = 0; index < 1000; ++index) {
+      snprintf(key, sizeof(key), "key%06d.x", index * 3);
+      false_positive += table->KeyMayMatch(key);
+      EXPECT_EQ(table->Get(ReadOptions(), key, &value), Status::kNotFound);
+    }
+    EXPECT_LT(false_positive, 50) << "sst_id=" << sst_id;
+    table_cache.Release(handle);
+  }
+  for (const uint64_t sst_id : {1, 7}) {
+    FileTool::RemoveFile(FileName::FileNameSSTable(kDBPath, sst_id));
+  }
+  FileTool::RemoveDir(kDBPath);
+}
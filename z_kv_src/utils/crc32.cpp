@@ -1,6 +1,14 @@
 #include "crc32.h"
 
+#include <string.h>
+
+#include <atomic>
+
 #include "codec.h"
+#if !HAVE_CRC32C && defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define Z_KV_HAVE_SSE42_CRC 1
+#endif
 
 namespace z_kv {
 using namespace util;
@@ -253,9 +261,148 @@ constexpr inline const uint8_t* RoundUp(const uint8_t* pointer) {
 
 }  // namespace
 
+#ifdef Z_KV_HAVE_SSE42_CRC
+namespace {
+// 多路并行计算之后需要把前一段的crc"平移"过后面一段的长度再合并，
+// 平移等价于在crc后面追加len个0字节，可以表示为GF(2)上的32x32矩阵，
+// 按字节查表计算(参考Mark Adler的crc32c实现)
+constexpr uint32_t kCRC32CPoly = 0x82f63b78;
+// 3路并行的两种段长度，必须是2的幂
+constexpr size_t kLongBlock = 8192;
+constexpr size_t kShortBlock = 256;
+
+uint32_t Gf2MatrixTimes(const uint32_t* mat, uint32_t vec) {
+  uint32_t sum = 0;
+  while (vec) {
+    if (vec & 1) {
+      sum ^= *mat;
+    }
+    vec >>= 1;
+    ++mat;
+  }
+  return sum;
+}
+void Gf2MatrixSquare(uint32_t* square, const uint32_t* mat) {
+  for (int n = 0; n < 32; ++n) {
+    square[n] = Gf2MatrixTimes(mat, mat[n]);
+  }
+}
+// 追加len(2的幂)个0字节的矩阵
+void ZerosOperator(uint32_t* even, size_t len) {
+  uint32_t odd[32];
+  odd[0] = kCRC32CPoly;
+  uint32_t row = 1;
+  for (int n = 1; n < 32; ++n) {
+    odd[n] = row;
+    row <<= 1;
+  }
+  Gf2MatrixSquare(even, odd);  // 2个0 bit
+  Gf2MatrixSquare(odd, even);  // 4个0 bit
+  do {
+    Gf2MatrixSquare(even, odd);
+    len >>= 1;
+    if (len == 0) {
+      return;
+    }
+    Gf2MatrixSquare(odd, even);
+    len >>= 1;
+  } while (len);
+  for (int n = 0; n < 32; ++n) {
+    even[n] = odd[n];
+  }
+}
+struct ShiftTable {
+  uint32_t zeros[4][256];
+  explicit ShiftTable(size_t len) {
+    uint32_t op[32];
+    ZerosOperator(op, len);
+    for (uint32_t n = 0; n < 256; ++n) {
+      zeros[0][n] = Gf2MatrixTimes(op, n);
+      zeros[1][n] = Gf2MatrixTimes(op, n << 8);
+      zeros[2][n] = Gf2MatrixTimes(op, n << 16);
+      zeros[3][n] = Gf2MatrixTimes(op, n << 24);
+    }
+  }
+  uint32_t Shift(uint32_t crc) const {
+    return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^
+           zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+  }
+};
+const ShiftTable& LongShift() {
+  static const ShiftTable table(kLongBlock);
+  return table;
+}
+const ShiftTable& ShortShift() {
+  static const ShiftTable table(kShortBlock);
+  return table;
+}
+inline uint64_t Load64(const uint8_t* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+// 把连续的3*block字节分成3段同时计算，crc32指令有3个周期的延迟，
+// 3路交错之后每个周期都能发射一条，最后把3个结果平移合并
+__attribute__((target("sse4.2"))) uint32_t Crc3Way(uint32_t crc0,
+                                                   const uint8_t** next,
+                                                   size_t* len, size_t block,
+                                                   const ShiftTable& shift) {
+  const uint8_t* p = *next;
+  while (*len >= block * 3) {
+    uint64_t c0 = crc0;
+    uint64_t c1 = 0;
+    uint64_t c2 = 0;
+    const uint8_t* end = p + block;
+    do {
+      c0 = _mm_crc32_u64(c0, Load64(p));
+      c1 = _mm_crc32_u64(c1, Load64(p + block));
+      c2 = _mm_crc32_u64(c2, Load64(p + block * 2));
+      p += 8;
+    } while (p < end);
+    crc0 = shift.Shift(static_cast<uint32_t>(c0)) ^ static_cast<uint32_t>(c1);
+    crc0 = shift.Shift(crc0) ^ static_cast<uint32_t>(c2);
+    p += block * 2;
+    *len -= block * 3;
+  }
+  *next = p;
+  return crc0;
+}
+__attribute__((target("sse4.2"))) uint32_t SSE42CRC32C(uint32_t crc,
+                                                       const char* buf,
+                                                       size_t size) {
+  const uint8_t* next = reinterpret_cast<const uint8_t*>(buf);
+  uint32_t crc0 = crc ^ 0xffffffffU;
+  // 先处理到8字节对齐
+  while (size > 0 && (reinterpret_cast<uintptr_t>(next) & 7) != 0) {
+    crc0 = _mm_crc32_u8(crc0, *next++);
+    --size;
+  }
+  crc0 = Crc3Way(crc0, &next, &size, kLongBlock, LongShift());
+  crc0 = Crc3Way(crc0, &next, &size, kShortBlock, ShortShift());
+  uint64_t crc64 = crc0;
+  while (size >= 8) {
+    crc64 = _mm_crc32_u64(crc64, Load64(next));
+    next += 8;
+    size -= 8;
+  }
+  crc0 = static_cast<uint32_t>(crc64);
+  while (size > 0) {
+    crc0 = _mm_crc32_u8(crc0, *next++);
+    --size;
+  }
+  return crc0 ^ 0xffffffffU;
+}
+}  // namespace
+#endif  // Z_KV_HAVE_SSE42_CRC
+
 static uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size) {
 #if HAVE_CRC32C
   return ::crc32c::Extend(crc, reinterpret_cast<const uint8_t*>(buf), size);
+#elif defined(Z_KV_HAVE_SSE42_CRC)
+  if (!__builtin_cpu_supports("sse4.2")) {
+    return 0;
+  }
+  return SSE42CRC32C(crc, buf, size);
 #else
   // Silence compiler warnings about unused arguments.
   (void)crc;
@@ -274,10 +421,13 @@ static bool CanAccelerateCRC32C() {
 
   return AcceleratedCRC32C(0, kTestCRCBuffer, kBufSize) == kTestCRCValue;
 }
+static std::atomic<bool> accelerate{CanAccelerateCRC32C()};
+void EnableAcceleration(bool enable) {
+  accelerate.store(enable && CanAccelerateCRC32C(), std::memory_order_relaxed);
+}
 
 uint32_t Extend(uint32_t crc, const char* data, size_t n) {
-  static bool accelerate = CanAccelerateCRC32C();
-  if (accelerate) {
+  if (accelerate.load(std::memory_order_relaxed)) {
     return AcceleratedCRC32C(crc, data, n);
   }
 
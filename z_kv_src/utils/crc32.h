@@ -9,6 +9,10 @@ namespace crc32 {
 // crc32c of a stream of data.
 uint32_t Extend(uint32_t init_crc, const char* data, size_t n);
 
+// CPU支持时使用硬件crc32指令(SSE4.2，3路并行)，结果和查表实现完全一致；
+// 用于测试和基准对比时关闭
+void EnableAcceleration(bool enable);
+
 // Return the crc32c of data[0,n-1]
 inline uint32_t Value(const char* data, size_t n) { return Extend(0, data, n); }
 
@@ -1,8 +1,252 @@
 #include "hash_util.h"
 
+#include <string.h>
+
+#include <atomic>
+
+#include "codec.h"
 #include "util.h"
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define Z_KV_HAVE_AVX2_HASH 1
+#endif
 namespace z_kv {
 namespace hash_util {
+namespace {
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime64_5 = 0x27D4EB2F165667C5ULL;
+constexpr uint32_t kPrime32_1 = 0x9E3779B1U;
+constexpr size_t kSecretSize = 192;
+constexpr size_t kStripeLen = 64;
+constexpr size_t kAccNum = kStripeLen / sizeof(uint64_t);
+// 每个stripe使用的secret向后错开8字节，一个block包含16个stripe(1KB)
+constexpr size_t kSecretConsumeRate = 8;
+constexpr size_t kStripesPerBlock =
+    (kSecretSize - kStripeLen) / kSecretConsumeRate;
+constexpr size_t kBlockLen = kStripeLen * kStripesPerBlock;
+
+struct Secret {
+  uint8_t bytes[kSecretSize];
+};
+// secret由splitmix64生成，属于磁盘格式的一部分，不能修改
+constexpr Secret MakeSecret() {
+  Secret secret{};
+  uint64_t state = kPrime64_1;
+  for (size_t i = 0; i < kSecretSize; i += sizeof(uint64_t)) {
+    state += 0x9E3779B97F4A7C15ULL;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    for (size_t j = 0; j < sizeof(uint64_t); ++j) {
+      secret.bytes[i + j] = static_cast<uint8_t>(z >> (j * 8));
+    }
+  }
+  return secret;
+}
+constexpr Secret kSecret = MakeSecret();
+constexpr uint64_t SecretWord(size_t offset) {
+  uint64_t value = 0;
+  for (size_t j = 0; j < sizeof(uint64_t); ++j) {
+    value |= static_cast<uint64_t>(kSecret.bytes[offset + j]) << (j * 8);
+  }
+  return value;
+}
+// 短key使用的secret在编译期算好
+constexpr uint64_t kShortSecret1_3 =
+    static_cast<uint32_t>(SecretWord(0)) ^ static_cast<uint32_t>(SecretWord(4));
+constexpr uint64_t kShortSecret4_8 = SecretWord(8) ^ SecretWord(16);
+constexpr uint64_t kShortSecret9_16Lo = SecretWord(24) ^ SecretWord(32);
+constexpr uint64_t kShortSecret9_16Hi = SecretWord(40) ^ SecretWord(48);
+constexpr uint64_t kShortSecret0 = SecretWord(56) ^ SecretWord(64);
+inline const char *SecretAt(size_t offset) {
+  return reinterpret_cast<const char *>(kSecret.bytes) + offset;
+}
+// 小端机器上直接读取，大端机器按小端解码，保证不同平台的结果一致
+inline uint64_t Read64(const char *p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+#else
+  return util::DecodeFixed64(p);
+#endif
+}
+inline uint32_t Read32(const char *p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+#else
+  return util::DecodeFixed32(p);
+#endif
+}
+inline uint64_t Mul128Fold64(uint64_t lhs, uint64_t rhs) {
+  const unsigned __int128 product =
+      static_cast<unsigned __int128>(lhs) * static_cast<unsigned __int128>(rhs);
+  return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+inline uint64_t Avalanche(uint64_t h) {
+  h ^= h >> 37;
+  h *= 0x165667919E3779F9ULL;
+  h ^= h >> 32;
+  return h;
+}
+inline uint64_t Fmix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= kPrime64_2;
+  h ^= h >> 29;
+  h *= kPrime64_3;
+  h ^= h >> 32;
+  return h;
+}
+inline uint64_t Mix16(const char *p, const char *secret, uint64_t seed) {
+  return Mul128Fold64(Read64(p) ^ (Read64(secret) + seed),
+                      Read64(p + 8) ^ (Read64(secret + 8) - seed));
+}
+uint64_t HashShort(const char *p, size_t len, uint64_t seed) {
+  if (len > 8) {
+    const uint64_t lo = Read64(p) ^ (kShortSecret9_16Lo + seed);
+    const uint64_t hi = Read64(p + len - 8) ^ (kShortSecret9_16Hi - seed);
+    const uint64_t acc =
+        len + __builtin_bswap64(lo) + hi + Mul128Fold64(lo, hi);
+    return Avalanche(acc);
+  }
+  if (len >= 4) {
+    const uint64_t combined =
+        Read32(p + len - 4) + (static_cast<uint64_t>(Read32(p)) << 32);
+    const uint64_t keyed = combined ^ (kShortSecret4_8 - seed);
+    return Fmix64(keyed + len * kPrime64_4);
+  }
+  if (len > 0) {
+    const uint32_t combined = (static_cast<uint32_t>(static_cast<uint8_t>(p[0])) << 16) |
+                              (static_cast<uint32_t>(static_cast<uint8_t>(p[len >> 1])) << 24) |
+                              static_cast<uint32_t>(static_cast<uint8_t>(p[len - 1])) |
+                              (static_cast<uint32_t>(len) << 8);
+    const uint64_t keyed = combined ^ (kShortSecret1_3 + seed);
+    return Fmix64(keyed);
+  }
+  return Fmix64(seed ^ kShortSecret0);
+}
+uint64_t HashMedium(const char *p, size_t len, uint64_t seed) {
+  // 前后对称地取16字节，最多覆盖128字节
+  uint64_t acc = len * kPrime64_1;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += Mix16(p + 48, SecretAt(96), seed);
+        acc += Mix16(p + len - 64, SecretAt(112), seed);
+      }
+      acc += Mix16(p + 32, SecretAt(64), seed);
+      acc += Mix16(p + len - 48, SecretAt(80), seed);
+    }
+    acc += Mix16(p + 16, SecretAt(32), seed);
+    acc += Mix16(p + len - 32, SecretAt(48), seed);
+  }
+  acc += Mix16(p, SecretAt(0), seed);
+  acc += Mix16(p + len - 16, SecretAt(16), seed);
+  return Avalanche(acc);
+}
+// 一个stripe：acc[i] += (data^secret)的低32位*高32位，同时acc[i^1] += data
+void AccumulateScalar(uint64_t *acc, const char *p, const char *secret,
+                      size_t stripes) {
+  for (size_t n = 0; n < stripes; ++n) {
+    const char *stripe = p + n * kStripeLen;
+    const char *key = secret + n * kSecretConsumeRate;
+    for (size_t i = 0; i < kAccNum; ++i) {
+      const uint64_t data_val = Read64(stripe + 8 * i);
+      const uint64_t data_key = data_val ^ Read64(key + 8 * i);
+      acc[i ^ 1] += data_val;
+      acc[i] += (data_key & 0xFFFFFFFFULL) * (data_key >> 32);
+    }
+  }
+}
+#ifdef Z_KV_HAVE_AVX2_HASH
+__attribute__((target("avx2"))) void AccumulateAvx2(uint64_t *acc,
+                                                    const char *p,
+                                                    const char *secret,
+                                                    size_t stripes) {
+  __m256i acc0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc));
+  __m256i acc1 =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + 4));
+  for (size_t n = 0; n < stripes; ++n) {
+    const char *stripe = p + n * kStripeLen;
+    const char *key = secret + n * kSecretConsumeRate;
+    const __m256i data0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(stripe));
+    const __m256i data1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(stripe + 32));
+    const __m256i key0 = _mm256_xor_si256(
+        data0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(key)));
+    const __m256i key1 = _mm256_xor_si256(
+        data1,
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(key + 32)));
+    // 低32位*高32位
+    const __m256i product0 =
+        _mm256_mul_epu32(key0, _mm256_srli_epi64(key0, 32));
+    const __m256i product1 =
+        _mm256_mul_epu32(key1, _mm256_srli_epi64(key1, 32));
+    // 相邻的两个64位交换，对应acc[i^1] += data
+    const __m256i swap0 = _mm256_shuffle_epi32(data0, _MM_SHUFFLE(1, 0, 3, 2));
+    const __m256i swap1 = _mm256_shuffle_epi32(data1, _MM_SHUFFLE(1, 0, 3, 2));
+    acc0 = _mm256_add_epi64(acc0, _mm256_add_epi64(product0, swap0));
+    acc1 = _mm256_add_epi64(acc1, _mm256_add_epi64(product1, swap1));
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc), acc0);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + 4), acc1);
+}
+bool CpuSupportsAvx2() { return __builtin_cpu_supports("avx2"); }
+#else
+bool CpuSupportsAvx2() { return false; }
+#endif
+std::atomic<bool> use_simd{CpuSupportsAvx2()};
+inline void Accumulate(uint64_t *acc, const char *p, const char *secret,
+                       size_t stripes) {
+#ifdef Z_KV_HAVE_AVX2_HASH
+  if (use_simd.load(std::memory_order_relaxed)) {
+    AccumulateAvx2(acc, p, secret, stripes);
+    return;
+  }
+#endif
+  AccumulateScalar(acc, p, secret, stripes);
+}
+void Scramble(uint64_t *acc) {
+  const char *secret = SecretAt(kSecretSize - kStripeLen);
+  for (size_t i = 0; i < kAccNum; ++i) {
+    uint64_t a = acc[i];
+    a ^= a >> 47;
+    a ^= Read64(secret + 8 * i);
+    a *= kPrime32_1;
+    acc[i] = a;
+  }
+}
+uint64_t HashLong(const char *p, size_t len, uint64_t seed) {
+  uint64_t acc[kAccNum] = {kPrime32_1, kPrime64_1, kPrime64_2, kPrime64_3,
+                           kPrime64_4, kPrime32_1, kPrime64_5, kPrime64_1};
+  acc[0] += seed;
+  acc[1] -= seed;
+  const size_t block_num = (len - 1) / kBlockLen;
+  for (size_t n = 0; n < block_num; ++n) {
+    Accumulate(acc, p + n * kBlockLen, SecretAt(0), kStripesPerBlock);
+    Scramble(acc);
+  }
+  // 最后一个block中完整的stripe，再加上以数据末尾对齐的最后一个stripe
+  const size_t stripes = ((len - 1) - kBlockLen * block_num) / kStripeLen;
+  Accumulate(acc, p + block_num * kBlockLen, SecretAt(0), stripes);
+  Accumulate(acc, p + len - kStripeLen, SecretAt(kSecretSize - kStripeLen - 7),
+             1);
+  uint64_t result = len * kPrime64_1;
+  for (size_t i = 0; i < kAccNum / 2; ++i) {
+    const char *secret = SecretAt(11 + 16 * i);
+    result += Mul128Fold64(acc[2 * i] ^ Read64(secret),
+                           acc[2 * i + 1] ^ Read64(secret + 8));
+  }
+  return Avalanche(result);
+}
+}  // namespace
 uint32_t SimMurMurHash(const char *data, uint32_t len) {
   if (len <= 0 || !data) {
     return 0;
@@ -35,6 +279,33 @@ uint32_t SimMurMurHash(const char *data, uint32_t len) {
   }
   return h;
 }
+uint64_t SimMurMurHash64(const char *data, uint32_t len) {
+  // FNV-1a，最后用murmur3的finalizer打散
+  uint32_t low = 0x811c9dc5;
+  for (uint32_t i = 0; i < len; ++i) {
+    low ^= static_cast<uint8_t>(data[i]);
+    low *= 0x01000193;
+  }
+  low ^= len;
+  low ^= low >> 16;
+  low *= 0x85ebca6b;
+  low ^= low >> 13;
+  low *= 0xc2b2ae35;
+  low ^= low >> 16;
+  return (static_cast<uint64_t>(SimMurMurHash(data, len)) << 32) | low;
+}
+uint64_t Hash64(const char *data, size_t len, uint64_t seed) {
+  if (len <= 16) {
+    return HashShort(data, len, seed);
+  }
+  if (len <= 128) {
+    return HashMedium(data, len, seed);
+  }
+  return HashLong(data, len, seed);
+}
+void EnableSimd(bool enable) {
+  use_simd.store(enable && CpuSupportsAvx2(), std::memory_order_relaxed);
+}
 }  // namespace hash_util
 
 }  // namespace corekv
@@ -1,8 +1,21 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 namespace z_kv {
 namespace hash_util {
 uint32_t SimMurMurHash(const char *data, uint32_t len);
+// 过滤器使用的64位hash：高32位就是SimMurMurHash(和已有的布隆过滤器格式兼容)，
+// 低32位是另一个独立的hash，需要多个hash值的过滤器(分块布隆/xor)同时使用两部分
+uint64_t SimMurMurHash64(const char *data, uint32_t len);
+// 持久化到磁盘的Hash64(过滤器、data block的hash索引)的算法版本，
+// 修改Hash64的输出必须增加版本号，读取时根据sst中记录的版本选择hash函数
+// 0表示旧的SimMurMurHash/SimMurMurHash64
+static constexpr uint32_t kHash64Version = 1;
+// XXH3风格的64位hash：短key(<=16字节)走无循环的分支，
+// 长key按64字节的stripe用8个64位累加器处理，支持AVX2时向量化累加
+uint64_t Hash64(const char *data, size_t len, uint64_t seed = 0);
+// 是否使用AVX2累加(CPU支持时默认开启)，两种实现的结果完全一致，用于测试和基准对比
+void EnableSimd(bool enable);
 }  // namespace hash_utl
 
 }  // namespace corekv
@@ -0,0 +1,320 @@
+#include "lz_compress.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "codec.h"
+namespace z_kv {
+namespace lz {
+namespace {
+static constexpr uint32_t kHashBits = 12;
+static constexpr uint32_t kHashTableSize = 1 << kHashBits;
+static constexpr uint32_t kTokenMask = 0xF;
+
+inline uint32_t Load32(const char* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+inline uint32_t HashPosition(const char* p) {
+  return (Load32(p) * 2654435761u) >> (32 - kHashBits);
+}
+// 长度大于等于15时，剩余部分每个字节255的方式追加
+inline void PutExtendLength(std::string* output, size_t length) {
+  while (length >= 255) {
+    output->push_back(static_cast<char>(255));
+    length -= 255;
+  }
+  output->push_back(static_cast<char>(length));
+}
+inline bool GetExtendLength(const char** p, const char* limit,
+                            size_t* length) {
+  uint8_t byte = 0;
+  do {
+    if (*p >= limit) {
+      return false;
+    }
+    byte = static_cast<uint8_t>(**p);
+    ++(*p);
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+// 写入一个sequence，match_length为0表示最后一个只有字面量的sequence
+void EmitSequence(std::string* output, const char* literal,
+                  size_t literal_length, uint32_t offset,
+                  size_t match_length) {
+  const size_t match_code = match_length > 0 ? match_length - kMinMatch : 0;
+  uint8_t token =
+      (literal_length < kTokenMask ? literal_length : kTokenMask) << 4;
+  token |= match_code < kTokenMask ? match_code : kTokenMask;
+  output->push_back(static_cast<char>(token));
+  if (literal_length >= kTokenMask) {
+    PutExtendLength(output, literal_length - kTokenMask);
+  }
+  output->append(literal, literal_length);
+  if (match_length == 0) {
+    return;
+  }
+  output->push_back(static_cast<char>(offset & 0xff));
+  output->push_back(static_cast<char>(offset >> 8));
+  if (match_code >= kTokenMask) {
+    PutExtendLength(output, match_code - kTokenMask);
+  }
+}
+}  // namespace
+
+namespace {
+// base[0, start)是历史数据(字典)，压缩base[start, limit)，table中保存的位置都是相对base的
+void CompressFrom(const char* base, size_t start, size_t limit,
+                  uint32_t* table, std::string* output) {
+  const char* const end = base + limit;
+  const char* ip = base + start;
+  const char* anchor = ip;
+  while (ip + kMinMatch <= end) {
+    const uint32_t hash = HashPosition(ip);
+    const uint32_t candidate_pos = table[hash];
+    table[hash] = static_cast<uint32_t>(ip - base) + 1;
+    if (candidate_pos == 0) {
+      ++ip;
+      continue;
+    }
+    const char* candidate = base + candidate_pos - 1;
+    const uint32_t offset = static_cast<uint32_t>(ip - candidate);
+    if (offset > kMaxOffset || Load32(candidate) != Load32(ip)) {
+      ++ip;
+      continue;
+    }
+    // 向后扩展匹配
+    const char* match_end = ip + kMinMatch;
+    const char* ref = candidate + kMinMatch;
+    while (match_end < end && *match_end == *ref) {
+      ++match_end;
+      ++ref;
+    }
+    EmitSequence(output, anchor, ip - anchor, offset, match_end - ip);
+    // 匹配中间的位置也放入哈希表，提高后续的命中率
+    for (const char* p = ip + 1; p + kMinMatch <= end && p < match_end; p += 2) {
+      table[HashPosition(p)] = static_cast<uint32_t>(p - base) + 1;
+    }
+    ip = match_end;
+    anchor = ip;
+  }
+  EmitSequence(output, anchor, end - anchor, 0, 0);
+}
+}  // namespace
+
+Dictionary::Dictionary(std::string data)
+    : data_(std::move(data)), table_(kHashTableSize, 0) {
+  if (data_.size() > kMaxDictSize) {
+    // 只保留尾部，尾部是出现次数最多的片段
+    data_.erase(0, data_.size() - kMaxDictSize);
+  }
+  for (size_t pos = 0; pos + kMinMatch <= data_.size(); ++pos) {
+    table_[HashPosition(data_.data() + pos)] = static_cast<uint32_t>(pos) + 1;
+  }
+}
+
+void Compress(const char* input, size_t length, std::string* output) {
+  util::PutVarint32(output, static_cast<uint32_t>(length));
+  // 哈希表保存的是4字节前缀上一次出现的位置(+1，0表示不存在)
+  uint32_t table[kHashTableSize];
+  memset(table, 0, sizeof(table));
+  CompressFrom(input, 0, length, table, output);
+}
+
+void Compress(const Dictionary* dict, const char* input, size_t length,
+              std::string* output) {
+  if (dict == nullptr || dict->data_.empty()) {
+    Compress(input, length, output);
+    return;
+  }
+  util::PutVarint32(output, static_cast<uint32_t>(length));
+  uint32_t table[kHashTableSize];
+  memcpy(table, dict->table_.data(), sizeof(table));
+  // 字典和数据拼接在一起，匹配可以从字典延续到数据中
+  std::string window;
+  window.reserve(dict->data_.size() + length);
+  window.append(dict->data_);
+  window.append(input, length);
+  CompressFrom(window.data(), dict->data_.size(), window.size(), table,
+               output);
+}
+
+bool GetUncompressedLength(const char* input, size_t length, size_t* result) {
+  uint32_t raw_length = 0;
+  if (util::GetVarint32Ptr(input, input + length, &raw_length) == nullptr) {
+    return false;
+  }
+  *result = raw_length;
+  return true;
+}
+
+bool Uncompress(const char* input, size_t length, std::string* output) {
+  return Uncompress(std::string_view(), input, length, output);
+}
+
+bool Uncompress(std::string_view dict, const char* input, size_t length,
+                std::string* output) {
+  const char* limit = input + length;
+  uint32_t raw_length = 0;
+  const char* p = util::GetVarint32Ptr(input, limit, &raw_length);
+  if (p == nullptr) {
+    return false;
+  }
+  output->resize(raw_length);
+  char* const dst = output->data();
+  size_t op = 0;
+  while (p < limit) {
+    const uint8_t token = static_cast<uint8_t>(*p++);
+    size_t literal_length = token >> 4;
+    if (literal_length == kTokenMask &&
+        !GetExtendLength(&p, limit, &literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<size_t>(limit - p) ||
+        literal_length > raw_length - op) {
+      return false;
+    }
+    memcpy(dst + op, p, literal_length);
+    p += literal_length;
+    op += literal_length;
+    // 最后一个sequence没有匹配部分
+    if (p == limit) {
+      break;
+    }
+    if (limit - p < 2) {
+      return false;
+    }
+    const uint32_t offset = static_cast<uint8_t>(p[0]) |
+                            (static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 8);
+    p += 2;
+    size_t match_length = token & kTokenMask;
+    if (match_length == kTokenMask &&
+        !GetExtendLength(&p, limit, &match_length)) {
+      return false;
+    }
+    match_length += kMinMatch;
+    if (offset == 0 || offset > op + dict.size() ||
+        match_length > raw_length - op) {
+      return false;
+    }
+    if (offset > op) {
+      // 匹配从字典开始，可能延续到已经解压的数据中
+      size_t dict_pos = dict.size() - (offset - op);
+      for (size_t i = 0; i < match_length; ++i, ++dict_pos) {
+        dst[op + i] = dict_pos < dict.size() ? dict[dict_pos]
+                                             : dst[dict_pos - dict.size()];
+      }
+      op += match_length;
+      continue;
+    }
+    // 偏移小于匹配长度时源和目标重叠，只能逐字节复制
+    const char* src = dst + op - offset;
+    if (offset >= match_length) {
+      memcpy(dst + op, src, match_length);
+    } else {
+      for (size_t i = 0; i < match_length; ++i) {
+        dst[op + i] = src[i];
+      }
+    }
+    op += match_length;
+  }
+  return op == raw_length;
+}
+
+std::string TrainDictionary(const std::vector<std::string_view>& samples,
+                            size_t dict_size) {
+  static constexpr size_t kDmerSize = 8;
+  static constexpr size_t kSegmentSize = 64;
+  std::string dict;
+  if (dict_size > kMaxDictSize) {
+    dict_size = kMaxDictSize;
+  }
+  size_t total_size = 0;
+  for (const auto& sample : samples) {
+    total_size += sample.size();
+  }
+  if (dict_size < kSegmentSize || total_size < kSegmentSize) {
+    return dict;
+  }
+  // 样本总量不比字典大时，直接使用样本
+  if (total_size <= dict_size) {
+    for (const auto& sample : samples) {
+      dict.append(sample.data(), sample.size());
+    }
+    return dict;
+  }
+  // 统计每个dmer出现的次数
+  std::unordered_map<uint64_t, uint32_t> frequency;
+  frequency.reserve(total_size);
+  for (const auto& sample : samples) {
+    for (size_t pos = 0; pos + kDmerSize <= sample.size(); ++pos) {
+      uint64_t dmer;
+      memcpy(&dmer, sample.data() + pos, sizeof(dmer));
+      ++frequency[dmer];
+    }
+  }
+  auto segment_score = [&frequency](const char* segment) {
+    uint64_t score = 0;
+    for (size_t pos = 0; pos + kDmerSize <= kSegmentSize; ++pos) {
+      uint64_t dmer;
+      memcpy(&dmer, segment + pos, sizeof(dmer));
+      auto iter = frequency.find(dmer);
+      // 只出现一次的片段对压缩没有帮助
+      if (iter != frequency.end() && iter->second > 1) {
+        score += iter->second;
+      }
+    }
+    return score;
+  };
+  // 按样本的顺序把所有数据划分成字典段数个epoch，每个epoch选出一个得分最高的段
+  const size_t epoch_num = dict_size / kSegmentSize;
+  const size_t epoch_size = std::max(total_size / epoch_num, kSegmentSize);
+  std::vector<std::pair<uint64_t, std::string_view>> selected;
+  size_t sample_index = 0, sample_pos = 0;
+  for (size_t epoch = 0; epoch < epoch_num && sample_index < samples.size();
+       ++epoch) {
+    uint64_t best_score = 0;
+    std::string_view best_segment;
+    size_t scanned = 0;
+    while (scanned < epoch_size && sample_index < samples.size()) {
+      const auto& sample = samples[sample_index];
+      if (sample_pos + kSegmentSize > sample.size()) {
+        scanned += sample.size() - std::min(sample_pos, sample.size());
+        ++sample_index;
+        sample_pos = 0;
+        continue;
+      }
+      const uint64_t score = segment_score(sample.data() + sample_pos);
+      if (score > best_score) {
+        best_score = score;
+        best_segment = sample.substr(sample_pos, kSegmentSize);
+      }
+      sample_pos += kDmerSize;
+      scanned += kDmerSize;
+    }
+    if (best_score == 0) {
+      continue;
+    }
+    // 已经选中的dmer不再计分，避免字典中出现重复的内容
+    for (size_t pos = 0; pos + kDmerSize <= best_segment.size(); ++pos) {
+      uint64_t dmer;
+      memcpy(&dmer, best_segment.data() + pos, sizeof(dmer));
+      frequency.erase(dmer);
+    }
+    selected.emplace_back(best_score, best_segment);
+  }
+  // 得分高的放在尾部，离待压缩数据近，偏移更小
+  std::stable_sort(selected.begin(), selected.end(),
+                   [](const auto& lhs, const auto& rhs) {
+                     return lhs.first < rhs.first;
+                   });
+  for (const auto& item : selected) {
+    dict.append(item.second.data(), item.second.size());
+  }
+  return dict;
+}
+}  // namespace lz
+}  // namespace corekv
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+namespace z_kv {
+// 内置的LZ系列块压缩算法(和lz4的格式思路一致)，不依赖外部库
+// 压缩后的格式：|varint32原始长度|sequence...|
+// sequence：|token(高4位字面量长度，低4位匹配长度-4)|扩展字面量长度|字面量|
+//           |2字节偏移|扩展匹配长度|
+// 最后一个sequence只有字面量部分
+// 使用字典时，字典被当作解压数据之前的历史数据，匹配的偏移可以指向字典
+namespace lz {
+// 最短匹配长度
+static constexpr uint32_t kMinMatch = 4;
+// 回溯窗口，偏移用2个字节保存
+static constexpr uint32_t kMaxOffset = 65535;
+
+// 字典的最大长度，需要给block本身留出回溯窗口
+static constexpr uint32_t kMaxDictSize = 32 * 1024;
+
+// 训练好的字典，构造时预先计算好字典的哈希表，每个block压缩时直接复用
+class Dictionary final {
+ public:
+  explicit Dictionary(std::string data);
+  Dictionary(const Dictionary&) = delete;
+  Dictionary& operator=(const Dictionary&) = delete;
+  const std::string& Data() const { return data_; }
+
+ private:
+  friend void Compress(const Dictionary* dict, const char* input,
+                       size_t length, std::string* output);
+  std::string data_;
+  std::vector<uint32_t> table_;
+};
+
+// 压缩input，结果追加到output中
+void Compress(const char* input, size_t length, std::string* output);
+// 基于字典压缩，dict为空时和不使用字典一致
+void Compress(const Dictionary* dict, const char* input, size_t length,
+              std::string* output);
+// 获取压缩数据解压之后的长度
+bool GetUncompressedLength(const char* input, size_t length, size_t* result);
+// 解压input，结果写入output(覆盖原有内容)，数据损坏时返回false
+bool Uncompress(const char* input, size_t length, std::string* output);
+// 解压基于字典压缩的数据，dict需要和压缩时使用的一致
+bool Uncompress(std::string_view dict, const char* input, size_t length,
+                std::string* output);
+// 从样本中训练字典(简化版的COVER算法)：统计8字节片段在样本中出现的次数，
+// 把样本分成若干段，每段选出得分最高的片段放入字典，出现次数多的片段放在字典尾部
+std::string TrainDictionary(const std::vector<std::string_view>& samples,
+                            size_t dict_size);
+}  // namespace lz
+}  // namespace corekv
@@ -49,8 +49,24 @@ class MutexLock final {
   void UnLock() { pthread_mutex_unlock(&mutex_); }
 
  private:
+  friend class CondVar;
   pthread_mutex_t mutex_;
 };
+// 条件变量，需要和MutexLock配合使用，调用Wait之前必须已经加锁
+class CondVar final {
+ public:
+  explicit CondVar(MutexLock* mutex) : mutex_(mutex) {
+    pthread_cond_init(&cond_, NULL);
+  }
+  ~CondVar() { pthread_cond_destroy(&cond_); }
+  void Wait() { pthread_cond_wait(&cond_, &mutex_->mutex_); }
+  void Signal() { pthread_cond_signal(&cond_); }
+  void SignalAll() { pthread_cond_broadcast(&cond_); }
+
+ private:
+  pthread_cond_t cond_;
+  MutexLock* mutex_;
+};
 //自旋锁
 class SpinLock final {
 #ifndef __APPLE__
@@ -0,0 +1,57 @@
+#include "thread_pool.h"
+
+namespace z_kv {
+ThreadPool::ThreadPool(uint32_t thread_num)
+    : task_cv_(&mutex_), idle_cv_(&mutex_) {
+  if (thread_num == 0) {
+    thread_num = 1;
+  }
+  threads_.reserve(thread_num);
+  for (uint32_t index = 0; index < thread_num; ++index) {
+    threads_.emplace_back(&ThreadPool::WorkLoop, this);
+  }
+}
+ThreadPool::~ThreadPool() {
+  {
+    ScopedLockImpl<MutexLock> lock_guard(mutex_);
+    shutting_down_ = true;
+    task_cv_.SignalAll();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+void ThreadPool::Schedule(std::function<void()> task) {
+  ScopedLockImpl<MutexLock> lock_guard(mutex_);
+  tasks_.emplace_back(std::move(task));
+  task_cv_.Signal();
+}
+void ThreadPool::WaitForIdle() {
+  ScopedLockImpl<MutexLock> lock_guard(mutex_);
+  while (!tasks_.empty() || running_ > 0) {
+    idle_cv_.Wait();
+  }
+}
+void ThreadPool::WorkLoop() {
+  ScopedLockImpl<MutexLock> lock_guard(mutex_);
+  while (true) {
+    while (tasks_.empty() && !shutting_down_) {
+      task_cv_.Wait();
+    }
+    // 退出前把剩余的任务执行完
+    if (tasks_.empty()) {
+      return;
+    }
+    auto task = std::move(tasks_.front());
+    tasks_.pop_front();
+    ++running_;
+    mutex_.UnLock();
+    task();
+    mutex_.Lock();
+    --running_;
+    if (tasks_.empty() && running_ == 0) {
+      idle_cv_.SignalAll();
+    }
+  }
+}
+}  // namespace corekv
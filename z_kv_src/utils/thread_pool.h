@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "mutex.h"
+namespace z_kv {
+// 简单的固定大小线程池，用于后台预热、压缩等任务
+class ThreadPool final {
+ public:
+  explicit ThreadPool(uint32_t thread_num);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  // 析构时会等待已经提交的任务全部执行完
+  ~ThreadPool();
+  void Schedule(std::function<void()> task);
+  // 阻塞直到所有已提交的任务执行完
+  void WaitForIdle();
+  uint32_t Size() const { return threads_.size(); }
+
+ private:
+  void WorkLoop();
+
+ private:
+  MutexLock mutex_;
+  CondVar task_cv_;
+  CondVar idle_cv_;
+  std::deque<std::function<void()>> tasks_;
+  // 正在执行的任务数
+  uint32_t running_ = 0;
+  bool shutting_down_ = false;
+  std::vector<std::thread> threads_;
+};
+}  // namespace corekv